@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "leaf_filter.hpp"
+
+// 3-wise binary fuse filter (Graf & Lemire, 2022) over 64-bit key hashes.
+// Every key maps to three slots in consecutive segments and the XOR of those
+// slots is the key's fingerprint: a probe is exactly three memory accesses,
+// at about 1.13 * sizeof(Fingerprint) bytes per key and a false-positive
+// rate of 2^-bits.
+template <typename Fingerprint>
+class BinaryFuseFilter : public LeafFilter {
+   public:
+    // keyHashes must be distinct
+    explicit BinaryFuseFilter(const std::vector<uint64_t>& keyHashes) {
+        size_t size = keyHashes.size();
+        if (size == 0) return;
+        segmentLength = size == 1 ? 4 : uint32_t{1} << static_cast<int>(std::floor(std::log(static_cast<double>(size)) / std::log(3.33) + 2.25));
+        segmentLength = std::min<uint32_t>(segmentLength, 1u << 18);
+        segmentLengthMask = segmentLength - 1;
+        double sizeFactor = size <= 1 ? 0.0 : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(static_cast<double>(size)));
+        size_t capacity = size <= 1 ? 0 : static_cast<size_t>(std::round(static_cast<double>(size) * sizeFactor));
+        size_t segmentCount = (capacity + segmentLength - 1) / segmentLength;
+        segmentCount = segmentCount <= kArity - 1 ? 1 : segmentCount - (kArity - 1);
+        segmentCountLength = segmentCount * segmentLength;
+        fingerprints.assign((segmentCount + kArity - 1) * segmentLength, 0);
+        populate(keyHashes);
+    }
+
+    bool contains(std::string_view value) const override {
+        if (fingerprints.empty()) return false;
+        return containsHash(leafFilterKeyHash(value));
+    }
+
+    bool containsHash(uint64_t keyHash) const {
+        uint64_t hash = leafFilterMix(keyHash + seed);
+        uint32_t h0, h1, h2;
+        slots(hash, h0, h1, h2);
+        return fingerprintOf(hash) == (fingerprints[h0] ^ fingerprints[h1] ^ fingerprints[h2]);
+    }
+
+    size_t memorySize() const override {
+        return fingerprints.capacity() * sizeof(Fingerprint) + sizeof(*this);
+    }
+
+    double falsePositiveRate() const override {
+        return std::ldexp(1.0, -static_cast<int>(8 * sizeof(Fingerprint)));
+    }
+
+    LeafFilterType type() const override {
+        return sizeof(Fingerprint) == 1 ? LeafFilterType::BinaryFuse8 : LeafFilterType::BinaryFuse16;
+    }
+
+   private:
+    static constexpr uint32_t kArity = 3;
+    static constexpr int kMaxAttempts = 100;
+
+    std::vector<Fingerprint> fingerprints;
+    uint64_t seed = 0;
+    uint32_t segmentLength = 0;
+    uint32_t segmentLengthMask = 0;
+    uint64_t segmentCountLength = 0;
+
+    static Fingerprint fingerprintOf(uint64_t hash) {
+        return static_cast<Fingerprint>(hash ^ (hash >> 32));
+    }
+
+    void slots(uint64_t hash, uint32_t& h0, uint32_t& h1, uint32_t& h2) const {
+        uint64_t hi = static_cast<uint64_t>((static_cast<unsigned __int128>(hash) * segmentCountLength) >> 64);
+        h0 = static_cast<uint32_t>(hi);
+        h1 = h0 + segmentLength;
+        h2 = h1 + segmentLength;
+        h1 ^= static_cast<uint32_t>(hash >> 18) & segmentLengthMask;
+        h2 ^= static_cast<uint32_t>(hash) & segmentLengthMask;
+    }
+
+    // Peels keys off slots hit by a single key; on failure retries with a
+    // new seed, which for distinct keys almost never takes more than one.
+    void populate(const std::vector<uint64_t>& keyHashes) {
+        size_t size = keyHashes.size();
+        size_t arrayLength = fingerprints.size();
+        std::vector<uint32_t> count(arrayLength);
+        std::vector<uint64_t> xorHash(arrayLength);
+        std::vector<uint8_t> xorSlot(arrayLength);
+        std::vector<uint64_t> stackHash(size);
+        std::vector<uint8_t> stackSlot(size);
+        std::vector<uint32_t> queue;
+
+        uint64_t seedState = 0x726b2b9d438b9d4dULL;
+        for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+            seedState += 0x9e3779b97f4a7c15ULL;
+            seed = leafFilterMix(seedState);
+            std::fill(count.begin(), count.end(), 0);
+            std::fill(xorHash.begin(), xorHash.end(), 0);
+            std::fill(xorSlot.begin(), xorSlot.end(), 0);
+
+            for (uint64_t keyHash : keyHashes) {
+                uint64_t hash = leafFilterMix(keyHash + seed);
+                uint32_t h[kArity];
+                slots(hash, h[0], h[1], h[2]);
+                for (uint32_t i = 0; i < kArity; ++i) {
+                    count[h[i]]++;
+                    xorHash[h[i]] ^= hash;
+                    xorSlot[h[i]] ^= static_cast<uint8_t>(i);
+                }
+            }
+
+            queue.clear();
+            for (uint32_t i = 0; i < arrayLength; ++i) {
+                if (count[i] == 1) queue.push_back(i);
+            }
+            size_t stackSize = 0;
+            while (!queue.empty()) {
+                uint32_t index = queue.back();
+                queue.pop_back();
+                if (count[index] != 1) continue;
+                uint64_t hash = xorHash[index];
+                uint8_t found = xorSlot[index];
+                stackHash[stackSize] = hash;
+                stackSlot[stackSize] = found;
+                stackSize++;
+
+                uint32_t h[kArity];
+                slots(hash, h[0], h[1], h[2]);
+                for (uint32_t i = 0; i < kArity; ++i) {
+                    count[h[i]]--;
+                    xorHash[h[i]] ^= hash;
+                    xorSlot[h[i]] ^= static_cast<uint8_t>(i);
+                    if (i != found && count[h[i]] == 1) queue.push_back(h[i]);
+                }
+            }
+
+            if (stackSize == size) {
+                // Assign in reverse peeling order, so every slot written is
+                // the last unassigned one of its key
+                for (size_t i = size; i-- > 0;) {
+                    uint64_t hash = stackHash[i];
+                    uint32_t h[kArity];
+                    slots(hash, h[0], h[1], h[2]);
+                    uint8_t found = stackSlot[i];
+                    fingerprints[h[found]] = fingerprintOf(hash) ^ fingerprints[h[(found + 1) % kArity]] ^ fingerprints[h[(found + 2) % kArity]];
+                }
+                return;
+            }
+        }
+        throw std::runtime_error("BinaryFuseFilter construction failed");
+    }
+};
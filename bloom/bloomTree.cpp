@@ -1,12 +1,8 @@
 #include "bloomTree.hpp"
 
-#include <unistd.h>
-
 #include <algorithm>
 #include <atomic>
-#include <climits>
-#include <cstdio>
-#include <filesystem>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 
@@ -15,22 +11,39 @@ extern std::atomic<size_t> gLeafBloomCheckCount;  // declared in algorithm.hpp
 
 void BloomTree::addLeafNode(BloomFilter&& bv, const std::string& file,
                             const std::string& start, const std::string& end) {
-    leafNodes.push_back(new Node(std::move(bv), file, start, end));
+    Node* leaf = &storage->nodes.emplace_back(std::move(bv), file, start, end);
+    leaf->leafIndex = static_cast<uint32_t>(storage->leaves.size());
+    storage->leaves.push_back(leaf);
+}
+
+void BloomTree::adoptLeaves(std::vector<Node>&& leaves) {
+    for (Node& leaf : leaves) {
+        Node* adopted = &storage->nodes.emplace_back(std::move(leaf));
+        adopted->leafIndex = static_cast<uint32_t>(storage->leaves.size());
+        storage->leaves.push_back(adopted);
+    }
+    leaves.clear();
 }
 
-void BloomTree::buildLevel(std::vector<Node*>& nodes) {
+void BloomTree::buildLevel(std::vector<Node*>& nodes, size_t level) {
     if (nodes.size() == 1) {
-        root = std::move(nodes.front());
+        root = nodes.front();
         return;
     }
 
     std::vector<Node*> parentLevel;
 
-    for (size_t i = 0; i < nodes.size(); i += ratio) {
-        size_t end = std::min(i + ratio, nodes.size());
+    const size_t groupSize = static_cast<size_t>(levelRatio(level));
+    for (size_t i = 0; i < nodes.size(); i += groupSize) {
+        size_t end = std::min(i + groupSize, nodes.size());
 
-        Node* parent = new Node(BloomFilter(bloomSize, numHashFunctions), "Memory",
-                                nodes[i]->startKey, nodes[end - 1]->endKey);
+        size_t parentBits = bloomSize;
+        if (internalFoldShift_ > 0 && nodes[i]->bloom.foldable()) {
+            size_t childBits = nodes[i]->bloom.bitArraySize;
+            parentBits = std::min(childBits, std::max(kMinFoldedBits, childBits >> internalFoldShift_));
+        }
+        Node* parent = &storage->nodes.emplace_back(BloomFilter(parentBits, numHashFunctions), "Memory",
+                                                    nodes[i]->startKey, nodes[end - 1]->endKey);
 
         for (size_t j = i; j < end; ++j) {
             if (parent->startKey > nodes[j]->startKey) {
@@ -39,127 +52,408 @@ void BloomTree::buildLevel(std::vector<Node*>& nodes) {
             if (parent->endKey < nodes[j]->endKey) {
                 parent->endKey = nodes[j]->endKey;
             }
-            parent->bloom.merge(nodes[j]->bloom);
-            parent->children.push_back(std::move(nodes[j]));
+            parent->bloom.mergeFolded(nodes[j]->bloom);
+            parent->children.push_back(nodes[j]);
         }
+        parent->refreshSetBits();
+        parent->updateFences();
+        fenceChildren(parent);
+        double fill = static_cast<double>(parent->setBits()) / parent->bloom.bitArraySize;
+        parent->passThrough = std::pow(fill, parent->bloom.numHashFunctions) >= kPassThroughFpp;
 
         parentLevel.push_back(parent);
     }
 
-    buildLevel(parentLevel);
+    buildLevel(parentLevel, level + 1);
 }
 
-void BloomTree::buildTree() {
-    buildLevel(leafNodes);
-    for (Node* node : leafNodes) {
-        node->bloom.saveToFile(node->filename + "_" + node->startKey + "_" + node->endKey);
-    }
+TreeShapeModel BloomTree::shapeModel(double positiveRate) const {
+    TreeShapeModel model;
+    model.leaves = storage->leaves.size();
+    model.bloomSize = bloomSize;
+    model.numHashFunctions = numHashFunctions;
+    model.positiveRate = positiveRate;
+    double items = 0.0;
+    for (const Node* leaf : storage->leaves) items += leaf->estimatedCardinality();
+    model.itemsPerLeaf = model.leaves ? items / model.leaves : 0.0;
+    return model;
 }
 
-void BloomTree::search(Node* node, const std::string& value,
-                       const std::string& qStart, const std::string& qEnd,
-                       std::vector<std::string>& results) const {
-    if (!node) return;
-
-    bool overlaps =
-        (qEnd.empty() || node->startKey <= qEnd) &&
-        (qStart.empty() || node->endKey >= qStart);
-
-    if (overlaps) {
-        ++gBloomCheckCount;
-        
-        // Track leaf bloom filter checks
-        if (node->filename != "Memory") {
-            ++gLeafBloomCheckCount;
+void BloomTree::buildTree(const std::string& segmentPath) {
+    if (storage->leaves.empty()) return;
+    // Leaves in start-key order keep every node's children sorted for
+    // ChildFences::overlapRange
+    std::stable_sort(storage->leaves.begin(), storage->leaves.end(),
+                     [](const Node* a, const Node* b) { return a->startRef() < b->startRef(); });
+    for (size_t i = 0; i < storage->leaves.size(); ++i) {
+        storage->leaves[i]->leafIndex = static_cast<uint32_t>(i);
+        storage->leaves[i]->refreshSetBits();
+    }
+    // buildLevel consumes the level it is given
+    std::vector<Node*> level = storage->leaves;
+    buildLevel(level, 0);
+    std::vector<const BloomFilter*> segmentFilters;
+    for (Node* node : storage->leaves) {
+        if (node->leafFilter) {
+            // Parents already hold the merged bits; keep only the fill count
+            node->bloom.releaseBits();
+            continue;
+        }
+        node->segmentSlot = static_cast<int32_t>(segmentFilters.size());
+        segmentFilters.push_back(&node->bloom);
+    }
+    if (!segmentPath.empty() && !segmentFilters.empty()) {
+        storage->segment = LeafSegment::create(segmentPath, segmentFilters);
+    }
+    if (childSlices_) {
+        for (Node& node : storage->nodes) {
+            if (!node.isLeaf()) node.childSlices = sliceChildren(&node);
         }
-        
-        if (node->bloom.exists(value)) {
-            if (node->filename != "Memory") {
-                results.push_back(node->filename);
+    }
+    profileLevels();
+}
+
+void BloomTree::profileLevels() {
+    constexpr size_t kFillSamplesPerLevel = 4;
+    TreeProfile profile;
+    std::vector<const Node*> level{root};
+    while (!level.empty()) {
+        TreeProfile::Level lp;
+        lp.nodes = level.size();
+        size_t step = std::max<size_t>(1, level.size() / kFillSamplesPerLevel);
+        size_t samples = 0;
+        double fppSum = 0.0;
+        double rowsSum = 0.0;
+        for (size_t i = 0; i < level.size() && samples < kFillSamplesPerLevel; i += step) {
+            const Node* node = level[i];
+            if (node->leafFilter) {
+                fppSum += node->leafFilter->falsePositiveRate();
             } else {
-                for (Node* child : node->children) {
-                    search(child, value, qStart, qEnd, results);
-                }
+                double fill = static_cast<double>(node->setBits()) / node->bloom.bitArraySize;
+                fppSum += std::pow(fill, node->bloom.numHashFunctions);
             }
+            rowsSum += node->estimatedCardinality();
+            ++samples;
+        }
+        lp.fpp = fppSum / samples;
+        profile.levels.push_back(lp);
+
+        std::vector<const Node*> next;
+        for (const Node* node : level) {
+            next.insert(next.end(), node->children.begin(), node->children.end());
+        }
+        if (next.empty()) {
+            profile.rowsPerLeaf = rowsSum / samples;
+            profile.totalRows = profile.rowsPerLeaf * level.size();
         }
+        level = std::move(next);
     }
+    storage->profile = std::move(profile);
 }
 
-std::vector<std::string> BloomTree::query(const std::string& value,
-                                          const std::string& qStart,
-                                          const std::string& qEnd) const {
-    std::vector<std::string> results;
-    search(root, value, qStart, qEnd, results);
-    return results;
+std::shared_ptr<ChildSlices> BloomTree::sliceChildren(const Node* parent) {
+    if (parent->children.empty() || parent->children.size() > ChildSlices::kMaxChildren) return nullptr;
+    std::vector<const BloomFilter*> filters;
+    for (const Node* child : parent->children) {
+        const BloomFilter& bf = child->bloom;
+        if (child->leafFilter || !bf.resident() ||
+            bf.bitArraySize != parent->children.front()->bloom.bitArraySize) {
+            return nullptr;
+        }
+        filters.push_back(&bf);
+    }
+    return std::make_shared<ChildSlices>(filters);
+}
+
+void BloomTree::fenceChildren(Node* parent) {
+    std::vector<KeyFence> starts, ends;
+    starts.reserve(parent->children.size());
+    ends.reserve(parent->children.size());
+    for (const Node* child : parent->children) {
+        starts.push_back(child->startFence);
+        ends.push_back(child->endFence);
+    }
+    parent->childFences = ChildFences(starts, ends);
 }
 
-// search that returns nodes
-void BloomTree::searchNodes(Node* node, const std::string& value,
-                            const std::string& qStart, const std::string& qEnd,
-                            std::vector<const Node*>& results) const {
-    if (!node) return;
+void BloomTree::queryLeaves(const std::string& value, const std::string& qStart,
+                            const std::string& qEnd, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (!root) return;
 
-    bool overlaps =
-        (qEnd.empty() || node->startKey <= qEnd) &&
-        (qStart.empty() || node->endKey >= qStart);
+    // probed: the parent's child slice answer for node, -1 to probe it
+    struct Pending {
+        const Node* node;
+        int8_t probed;
+    };
+    thread_local std::vector<Pending> stack;
+    thread_local std::vector<uint32_t> hashes;
+    stack.clear();
+    hashes.resize(static_cast<size_t>(root->bloom.numHashFunctions));
+    root->bloom.computeHashes(value, hashes.data());
 
-    if (overlaps) {
-        ++gBloomCheckCount;
-        
-        // Track leaf bloom filter checks
-        if (node->filename != "Memory") {
-            ++gLeafBloomCheckCount;
+    const bool bounded = !qStart.empty() || !qEnd.empty();
+    const KeyRef lo(qStart), hi(qEnd);
+    const KeyFence hiFence = qEnd.empty() ? KeyFence::max() : hi.fence;
+    auto overlaps = [&](const Node* node) {
+        return (qEnd.empty() || node->startRef() <= hi) && (qStart.empty() || node->endRef() >= lo);
+    };
+    if (!overlaps(root)) return;
+
+    // Children are range-checked before they are pushed, so every node
+    // popped overlaps the query
+    stack.push_back({root, -1});
+    while (!stack.empty()) {
+        auto [node, probed] = stack.back();
+        stack.pop_back();
+
+        bool isLeaf = node->isLeaf();
+        if (!node->passThrough) {
+            ++gBloomCheckCount;
+            if (isLeaf) ++gLeafBloomCheckCount;
         }
-        
-        if (node->bloom.exists(value)) {
-            if (node->children.empty()) {
-                results.push_back(node);
-            } else {
-                for (Node* child : node->children) {
-                    searchNodes(child, value, qStart, qEnd, results);
-                }
-            }
+        if (probed < 0 ? !node->mayContainHashes(value, hashes.data()) : probed == 0) continue;
+        if (isLeaf) {
+            out.push_back(node->leafIndex);
+            continue;
+        }
+
+        // Children go on in reverse so they come off in key order
+        const std::vector<Node*>& children = node->children;
+        auto [first, last] = bounded ? node->childFences.overlapRange(lo.fence, hiFence)
+                                     : std::pair<size_t, size_t>{0, children.size()};
+        if (first == last) continue;
+        uint64_t mask = node->childSlices ? node->childSlices->mayContain(hashes.data()) : 0;
+        for (size_t c = last; c-- > first;) {
+            if (bounded && !overlaps(children[c])) continue;
+            int8_t passed = -1;
+            if (node->childSlices) passed = children[c]->passThrough || ((mask >> c) & 1);
+            stack.push_back({children[c], passed});
         }
     }
 }
 
-// query where return type is vector of nodes
+std::vector<std::string> BloomTree::query(const std::string& value,
+                                          const std::string& qStart,
+                                          const std::string& qEnd) const {
+    std::vector<uint32_t> leaves;
+    queryLeaves(value, qStart, qEnd, leaves);
+    std::vector<std::string> results;
+    results.reserve(leaves.size());
+    for (uint32_t i : leaves) results.push_back(storage->leaves[i]->filename);
+    return results;
+}
+
 std::vector<const Node*> BloomTree::queryNodes(const std::string& value,
                                                const std::string& qStart,
                                                const std::string& qEnd) const {
+    std::vector<uint32_t> leaves;
+    queryLeaves(value, qStart, qEnd, leaves);
     std::vector<const Node*> results;
-    searchNodes(root, value, qStart, qEnd, results);
+    results.reserve(leaves.size());
+    for (uint32_t i : leaves) results.push_back(storage->leaves[i]);
     return results;
 }
 
-static size_t computeNodeMemory(const Node* node) {
-    if (!node) return 0;
-    size_t mem = 0;
+std::vector<std::vector<const Node*>> BloomTree::queryBatch(
+    std::span<const std::string> values, const std::string& qStart,
+    const std::string& qEnd) const {
+    std::vector<std::vector<const Node*>> results(values.size());
+    if (!root || values.empty()) return results;
+
+    // Every value is hashed once for the whole batch
+    const size_t k = static_cast<size_t>(root->bloom.numHashFunctions);
+    std::vector<uint32_t> hashes(values.size() * k);
+    for (size_t v = 0; v < values.size(); ++v) {
+        root->bloom.computeHashes(values[v], &hashes[v * k]);
+    }
+
+    // Frontier entry: a node and the indices of values still alive at it.
+    // When the parent's child slices already sieved live, probed values
+    // were checked against the node and live holds the ones that passed.
+    struct Entry {
+        const Node* node;
+        std::vector<uint32_t> live;
+        size_t probed = 0;
+        bool sieved = false;
+    };
+    std::vector<Entry> frontier;
+    std::vector<uint32_t> all(values.size());
+    for (uint32_t v = 0; v < values.size(); ++v) all[v] = v;
+    frontier.push_back({root, std::move(all)});
+
+    const KeyRef lo(qStart), hi(qEnd);
+    const KeyFence hiFence = qEnd.empty() ? KeyFence::max() : hi.fence;
+    std::vector<Entry> next;
+    std::vector<uint32_t> passing;
+    std::vector<uint64_t> masks;
+    while (!frontier.empty()) {
+        next.clear();
+        for (const auto& [node, live, probed, sieved] : frontier) {
+            bool overlaps =
+                (qEnd.empty() || node->startRef() <= hi) &&
+                (qStart.empty() || node->endRef() >= lo);
+            if (!overlaps) continue;
+
+            bool isLeaf = node->isLeaf();
+            if (!node->passThrough) {
+                size_t checks = sieved ? probed : live.size();
+                gBloomCheckCount += checks;
+                if (isLeaf) gLeafBloomCheckCount += checks;
+            }
 
-    mem += node->bloom.bitArray.capacity() / CHAR_BIT;
-    mem += sizeof(node->bloom.bitArray);
+            passing.clear();
+            if (node->passThrough || sieved) {
+                passing = live;
+            } else if (node->leafFilter) {
+                for (uint32_t v : live) {
+                    if (node->leafFilter->contains(values[v])) passing.push_back(v);
+                }
+            } else if (node->pagedBits) {
+                // One cache lookup for all values live at the leaf
+                auto bits = node->pagedBits->get(node->segmentSlot);
+                for (uint32_t v : live) {
+                    if (bits->existsHashes(&hashes[v * k])) passing.push_back(v);
+                }
+            } else {
+                for (uint32_t v : live) {
+                    if (node->bloom.existsHashes(&hashes[v * k])) {
+                        passing.push_back(v);
+                    }
+                }
+            }
+            if (passing.empty()) continue;
 
-    for (const Node* child : node->children) {
-        mem += computeNodeMemory(child);
+            if (isLeaf) {
+                for (uint32_t v : passing) results[v].push_back(node);
+                continue;
+            }
+            auto [first, last] = node->childFences.overlapRange(lo.fence, hiFence);
+            if (node->childSlices) {
+                masks.resize(passing.size());
+                for (size_t j = 0; j < passing.size(); ++j) {
+                    masks[j] = node->childSlices->mayContain(&hashes[passing[j] * k]);
+                }
+                for (size_t c = first; c < last; ++c) {
+                    const Node* child = node->children[c];
+                    Entry entry{child, {}, passing.size(), true};
+                    for (size_t j = 0; j < passing.size(); ++j) {
+                        if (child->passThrough || ((masks[j] >> c) & 1)) entry.live.push_back(passing[j]);
+                    }
+                    // A child rejecting every value still counts its checks
+                    next.push_back(std::move(entry));
+                }
+            } else {
+                for (size_t c = first; c < last; ++c) {
+                    next.push_back({node->children[c], passing});
+                }
+            }
+        }
+        frontier.swap(next);
     }
-    return mem;
+    return results;
 }
 
-static size_t computeBloomFilterDiskSize(const BloomFilter& bf) {
-    char tmpName[] = "/tmp/bloomXXXXXX";
-    int fd = mkstemp(tmpName);
-    if (fd == -1) {
-        throw std::runtime_error("mkstemp failed");
+// Root-to-leaf path to the counting leaf covering key, one of file's
+// partitions unless file is empty
+bool BloomTree::findUpdatePath(Node* node, const std::string& key, const std::string& file,
+                               std::vector<Node*>& path) const {
+    if (node->startKey > key || node->endKey < key) return false;
+    path.push_back(node);
+    if (node->children.empty()) {
+        if (node->counting && (file.empty() || node->filename == file)) return true;
+    } else {
+        for (Node* child : node->children) {
+            if (findUpdatePath(child, key, file, path)) return true;
+        }
     }
-    close(fd);
+    path.pop_back();
+    return false;
+}
 
-    bf.saveToFile(std::string(tmpName));
+bool BloomTree::applyValueUpdate(const std::string& column, const std::string& key,
+                                 const std::string& oldValue, const std::string& newValue,
+                                 const std::string& file) {
+    std::vector<Node*> path;
+    // Only the key's own partition is known to hold oldValue
+    bool holdsKey = root && !file.empty() && findUpdatePath(root, key, file, path);
+    if (!holdsKey) {
+        path.clear();
+        if (!root || !findUpdatePath(root, key, "", path)) {
+            spdlog::warn("No counting leaf covers key {} for an in-place update.", key);
+            return false;
+        }
+        spdlog::warn("No leaf of '{}' covers key {}, adding its new value to {} only.", file, key,
+                     path.back()->filename);
+    }
 
-    size_t size = std::filesystem::file_size(tmpName);
+    // Other copies of the tree share the storage: start one of our own on
+    // top of it. Path nodes copied by an earlier update change in place.
+    if (storage.use_count() > 1) {
+        auto next = std::make_shared<Storage>();
+        next->leaves = storage->leaves;
+        next->segment = storage->segment;
+        next->leafCache = storage->leafCache;
+        next->profile = storage->profile;
+        next->base = storage;
+        storage = std::move(next);
+    }
+    for (size_t level = 0; level < path.size(); ++level) {
+        if (storage->copies.count(path[level])) continue;
+        Node* copy = &storage->nodes.emplace_back(*path[level]);
+        storage->copies.insert(copy);
+        if (copy->counting) copy->counting = std::make_shared<CountingBloomFilter>(*copy->counting);
+        if (copy->childSlices) copy->childSlices = std::make_shared<ChildSlices>(*copy->childSlices);
+        if (level == 0) {
+            root = copy;
+        } else {
+            Node* parent = path[level - 1];
+            *std::find(parent->children.begin(), parent->children.end(), path[level]) = copy;
+        }
+        if (copy->isLeaf()) storage->leaves[copy->leafIndex] = copy;
+        path[level] = copy;
+    }
 
-    std::remove(tmpName);
+    Node* leaf = path.back();
+    std::vector<size_t> cleared;
+    if (holdsKey && !oldValue.empty() && leaf->counting->exists(oldValue)) {
+        cleared = leaf->counting->remove(oldValue);
+    }
+    std::vector<size_t> raised = leaf->counting->insert(newValue);
+    for (size_t p : cleared) leaf->bloom.assign(p, leaf->counting->counter(p) > 0);
+    for (size_t p : raised) leaf->bloom.set(p);
+    leaf->refreshSetBits();
+    leaf->liveColumn = column;
 
-    return size;
+    // Parent bits are the OR of their children's (folded down to the
+    // parent's size): set bits propagate as is, cleared ones are recomputed
+    // from the siblings level by level
+    for (size_t level = path.size() - 1; level-- > 0;) {
+        Node* parent = path[level];
+        if (parent->childSlices) {
+            const Node* child = path[level + 1];
+            size_t c = std::find(parent->children.begin(), parent->children.end(), child) - parent->children.begin();
+            size_t childBits = child->bloom.bitArraySize;
+            for (size_t p : raised) parent->childSlices->set(p % childBits, c, true);
+            for (size_t p : cleared) {
+                parent->childSlices->set(p % childBits, c, child->bloom.test(p % childBits));
+            }
+        }
+        size_t bits = parent->bloom.bitArraySize;
+        for (size_t p : raised) parent->bloom.set(p % bits);
+        for (size_t p : cleared) {
+            bool any = false;
+            for (const Node* child : parent->children) {
+                if (child->bloom.anyFoldedBit(p, bits)) {
+                    any = true;
+                    break;
+                }
+            }
+            parent->bloom.assign(p % bits, any);
+        }
+        parent->refreshSetBits();
+    }
+    return true;
 }
 
 size_t BloomTree::memorySize() const {
@@ -169,8 +463,8 @@ size_t BloomTree::memorySize() const {
     while (!stack.empty()) {
         const Node* node = stack.back();
         stack.pop_back();
-        if (node->filename == "Memory") {
-            total += computeBloomFilterDiskSize(node->bloom);
+        if (!node->isLeaf()) {
+            total += (node->bloom.bitArraySize + 7) / 8;
             for (const Node* child : node->children) {
                 stack.push_back(child);
             }
@@ -179,12 +473,172 @@ size_t BloomTree::memorySize() const {
     return total;
 }
 
+TreeStats BloomTree::stats() const {
+    TreeStats stats;
+    if (!root) return stats;
+    std::vector<const Node*> level{root};
+    std::vector<const Node*> next;
+    while (!level.empty()) {
+        LevelStats ls;
+        ls.nodes = level.size();
+        double fppSum = 0.0;
+        next.clear();
+        for (const Node* node : level) {
+            if (node->leafFilter) {
+                ls.bytes += node->leafFilter->memorySize();
+                fppSum += node->leafFilter->falsePositiveRate();
+            } else {
+                size_t setBits = node->setBits();
+                ls.bytes += (node->bloom.bitArraySize + 7) / 8;
+                ls.bits += node->bloom.bitArraySize;
+                ls.setBits += setBits;
+                ls.passThrough += node->passThrough;
+                ls.estimatedCardinality += node->bloom.estimateCardinality(setBits);
+                if (node->bloom.bitArraySize > 0) {
+                    double fill = static_cast<double>(setBits) / node->bloom.bitArraySize;
+                    fppSum += std::pow(fill, node->bloom.numHashFunctions);
+                }
+            }
+            if (node->childSlices) stats.childSliceBytes += node->childSlices->memorySize();
+            next.insert(next.end(), node->children.begin(), node->children.end());
+        }
+        ls.fill = ls.bits ? static_cast<double>(ls.setBits) / ls.bits : 0.0;
+        ls.fpp = fppSum / ls.nodes;
+        (next.empty() ? stats.leafBytes : stats.internalBytes) += ls.bytes;
+        stats.levels.push_back(ls);
+        level.swap(next);
+    }
+    return stats;
+}
+
 size_t BloomTree::diskSize() const {
+    // Bloom leaves live in the segment; static filters are not written out,
+    // their in-memory size stands in as before
+    size_t total = storage->segment ? storage->segment->fileBytes() : 0;
+    for (const Node* leaf : storage->leaves) {
+        if (leaf->leafFilter) total += leaf->leafFilter->memorySize();
+    }
+    return total;
+}
+
+size_t BloomTree::leafMemorySize() const {
     size_t total = 0;
-    for (const Node* leaf : leafNodes) {
-        if (leaf->filename != "Memory") {
-            total += computeBloomFilterDiskSize(leaf->bloom);
+    for (const Node* leaf : storage->leaves) {
+        if (leaf->leafFilter) {
+            total += leaf->leafFilter->memorySize();
+        } else if (!leaf->pagedBits) {
+            total += (leaf->bloom.bitArraySize + 7) / 8;
         }
     }
+    if (storage->leafCache) total += storage->leafCache->residentBytes();
     return total;
-}
\ No newline at end of file
+}
+
+void BloomTree::pageOutLeaves(size_t cacheBytes) {
+    if (!storage->segment) {
+        spdlog::warn("Tree has no leaf segment, keeping the leaf filters in memory.");
+        return;
+    }
+    auto cache = std::make_shared<LeafFilterCache>(storage->segment, cacheBytes, static_cast<size_t>(levelRatio(0)));
+    size_t paged = 0;
+    for (Node* leaf : storage->leaves) {
+        if (leaf->segmentSlot < 0 || leaf->counting || leaf->pagedBits) continue;
+        // The fill count was taken at build time and stays for the planner
+        leaf->bloom.releaseBits();
+        leaf->pagedBits = cache;
+        ++paged;
+    }
+    // Slices over paged leaves would keep a resident copy of their bits
+    size_t unsliced = 0;
+    for (Node& node : storage->nodes) {
+        if (!node.childSlices) continue;
+        for (const Node* child : node.children) {
+            if (child->pagedBits) {
+                node.childSlices.reset();
+                ++unsliced;
+                break;
+            }
+        }
+    }
+    if (unsliced > 0) spdlog::info("Dropped the child slices of {} parents of paged-out leaves.", unsliced);
+    storage->leafCache = std::move(cache);
+    spdlog::info("Paged out {} leaf filters to {}, cache budget {} bytes.", paged,
+                 storage->segment->path(), cacheBytes);
+}
+
+// Theoretical FPP of a filter with setBits of bits set once folded in half
+static double foldedFpp(size_t setBits, size_t bits, int numHashFunctions) {
+    double fill = static_cast<double>(setBits) / bits;
+    return std::pow(1.0 - (1.0 - fill) * (1.0 - fill), numHashFunctions);
+}
+
+BloomTree BloomTree::foldedToBudget(size_t internalBytes) const {
+    BloomTree folded = *this;
+    if (!root || root->isLeaf()) return folded;
+    if (!root->bloom.foldable()) {
+        spdlog::warn("Internal filters of {} bits cannot be folded, keeping them.", root->bloom.bitArraySize);
+        return folded;
+    }
+
+    // Fresh internal nodes; the leaves stay in (and keep alive) this storage
+    auto copy = std::make_shared<Storage>();
+    copy->leaves = storage->leaves;
+    copy->segment = storage->segment;
+    copy->leafCache = storage->leafCache;
+    copy->base = storage;
+    std::vector<std::vector<Node*>> levels{{&copy->nodes.emplace_back(*root)}};
+    while (true) {
+        std::vector<Node*> next;
+        for (Node* node : levels.back()) {
+            for (Node*& child : node->children) {
+                if (child->isLeaf()) continue;
+                child = &copy->nodes.emplace_back(*child);
+                next.push_back(child);
+            }
+        }
+        if (next.empty()) break;
+        levels.push_back(std::move(next));
+    }
+    folded.storage = copy;
+    folded.root = levels.front().front();
+
+    size_t total = folded.memorySize();
+    while (total > internalBytes) {
+        size_t best = levels.size();
+        double bestFpp = 0.0;
+        for (size_t l = 0; l < levels.size(); ++l) {
+            size_t bits = levels[l].front()->bloom.bitArraySize;
+            if (bits / 2 < kMinFoldedBits) continue;
+            if (l > 0 && bits / 2 < levels[l - 1].front()->bloom.bitArraySize) continue;
+            double fpp = 0.0;
+            for (const Node* node : levels[l]) {
+                fpp += foldedFpp(node->setBits(), bits, node->bloom.numHashFunctions);
+            }
+            fpp /= levels[l].size();
+            if (best == levels.size() || fpp < bestFpp) {
+                best = l;
+                bestFpp = fpp;
+            }
+        }
+        if (best == levels.size()) {
+            spdlog::warn("Internal filters cannot fold below {} bytes, budget {} bytes.", total, internalBytes);
+            break;
+        }
+        for (Node* node : levels[best]) {
+            total -= (node->bloom.bitArraySize + 7) / 8;
+            node->bloom.fold();
+            total += (node->bloom.bitArraySize + 7) / 8;
+            node->refreshSetBits();
+            double fill = static_cast<double>(node->setBits()) / node->bloom.bitArraySize;
+            node->passThrough = std::pow(fill, node->bloom.numHashFunctions) >= kPassThroughFpp;
+        }
+        if (best > 0) {
+            for (Node* parent : levels[best - 1]) {
+                if (parent->childSlices) parent->childSlices = sliceChildren(parent);
+            }
+        }
+    }
+    folded.profileLevels();
+    spdlog::info("Folded internal filters to {} bytes (budget {} bytes).", total, internalBytes);
+    return folded;
+}
@@ -1,30 +1,103 @@
 #pragma once
+#include <algorithm>
+#include <deque>
 #include <memory>
+#include <span>
+#include <unordered_set>
 #include <vector>
 
 #include "node.hpp"
+#include "tree_shape.hpp"
+
+// One level of a tree, levels[0] being the root. Bit counts and fill cover
+// the Bloom nodes of the level; static leaf filters only add bytes and fpp.
+struct LevelStats {
+    size_t nodes = 0;
+    size_t bytes = 0;
+    size_t bits = 0;
+    size_t setBits = 0;
+    size_t passThrough = 0;
+    double fill = 0.0;
+    // Sum of the per-node distinct item estimates
+    double estimatedCardinality = 0.0;
+    // Mean per-node false positive rate, fill^k for Bloom nodes
+    double fpp = 0.0;
+};
+
+struct TreeStats {
+    std::vector<LevelStats> levels;
+    size_t internalBytes = 0;
+    size_t leafBytes = 0;
+    size_t childSliceBytes = 0;
+};
+
+// Query planner inputs, taken once when the tree is built. Fill ratios are
+// sampled from a few nodes per level, unlike the full walk of stats().
+struct TreeProfile {
+    struct Level {
+        size_t nodes = 0;
+        double fpp = 0.0;  // mean fill^k over the sampled nodes of the level
+    };
+    std::vector<Level> levels;  // levels[0] is the root
+    double rowsPerLeaf = 0.0;
+    double totalRows = 0.0;
+
+    double fanout(size_t level) const {
+        return static_cast<double>(levels[level + 1].nodes) / levels[level].nodes;
+    }
+};
 
 class BloomTree {
    public:
-    Node* root;
+    Node* root = nullptr;
 
    private:
+    // Every node of the tree plus the leaf list. Shared by all copies of the
+    // tree, so a copy costs a pointer and the nodes live until the last one
+    // goes; the deque keeps node addresses (and the child links) stable.
+    struct Storage {
+        std::deque<Node> nodes;
+        std::vector<Node*> leaves;
+        std::shared_ptr<LeafSegment> segment;
+        std::shared_ptr<LeafFilterCache> leafCache;
+        // Storage the leaves live in when this one only holds re-folded
+        // internal nodes (see foldedToBudget)
+        std::shared_ptr<const Storage> base;
+        TreeProfile profile;
+        // Nodes applyValueUpdate copied into this storage; only these are
+        // changed in place
+        std::unordered_set<const Node*> copies;
+    };
+    std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+
     int ratio;
+    // Fanout per level, bottom-up; levels past the end use ratio
+    std::vector<int> levelRatios_;
     size_t bloomSize;
     int numHashFunctions;
+    // Parents are built this many folds below their children (0: full size)
+    int internalFoldShift_ = 0;
+    bool childSlices_ = false;
+    static constexpr size_t kMinFoldedBits = 1024;
 
     // for future use
     //  size_t expectedItems;
     //  double bloomFalsePositiveRate;
 
-    void buildLevel(std::vector<Node*>& nodes);
-    void search(Node* node, const std::string& value,
-                const std::string& qStart, const std::string& qEnd,
-                std::vector<std::string>& results) const;
+    void buildLevel(std::vector<Node*>& nodes, size_t level);
+    int levelRatio(size_t level) const {
+        return std::max(2, level < levelRatios_.size() ? levelRatios_[level] : ratio);
+    }
+    // Slices of parent's children, if they are all resident Bloom filters
+    // of one size; null otherwise
+    static std::shared_ptr<ChildSlices> sliceChildren(const Node* parent);
+    // Packs the key fences of parent's children into parent->childFences
+    static void fenceChildren(Node* parent);
+    // Recomputes storage->profile from the current nodes
+    void profileLevels();
 
-    void searchNodes(Node* node, const std::string& value,
-                     const std::string& qStart, const std::string& qEnd,
-                     std::vector<const Node*>& results) const;
+    bool findUpdatePath(Node* node, const std::string& key, const std::string& file,
+                        std::vector<Node*>& path) const;
 
    public:
     // for future use
@@ -37,12 +110,44 @@ class BloomTree {
           bloomSize(bloomSize),
           numHashFunctions(numHashFunctions) {}
 
-    std::vector<Node*> leafNodes;
+    const std::vector<Node*>& leafNodes() const { return storage->leaves; }
+    // Wall time of the whole build (partition scan, leaf filters, merges)
+    long long buildMicros = 0;
+    // Column family the tree indexes (empty if built outside buildHierarchies)
+    std::string column;
+    // Bloom checks per point query predicted by the shape cost model
+    double predictedBloomChecks = 0.0;
 
     void addLeafNode(BloomFilter&& bv, const std::string& file,
                      const std::string& start, const std::string& end);
+    // Takes over leaves built elsewhere, in order
+    void adoptLeaves(std::vector<Node>&& leaves);
+
+    // Cost model inputs from the current leaves and filter parameters
+    TreeShapeModel shapeModel(double positiveRate) const;
+    // Per-level fanouts for the next buildTree, bottom-up
+    void setLevelRatios(std::vector<int> ratios) { levelRatios_ = std::move(ratios); }
+    const std::vector<int>& levelRatios() const { return levelRatios_; }
+    int branchingRatio() const { return ratio; }
+    // Builds each internal level at 1 / 2^shift the size of the level below
+    // by folding; needs power-of-two filter sizes, ignored otherwise
+    void setInternalFoldShift(int shift) { internalFoldShift_ = std::max(0, shift); }
+    // Gives every internal node a bit-sliced copy of its children's filters,
+    // so one probe answers for all of them. Stores one word per child bit
+    // position, 8/16/32/64 bits wide by fanout: at fanout 3 that is about
+    // 2.7x the bits of the children.
+    void setChildSlices(bool enabled) { childSlices_ = enabled; }
+
+    // Merges the levels above the leaves. With a segmentPath, the bits of
+    // the Bloom leaves are also written to one LeafSegment there.
+    void buildTree(const std::string& segmentPath = "");
 
-    void buildTree();
+    // Indices into leafNodes() of the candidate leaves for value, in key
+    // order, written to out (cleared first). Walks an explicit stack kept
+    // per thread and hashes the value once, so with an out buffer reused
+    // across calls a query does no heap allocation.
+    void queryLeaves(const std::string& value, const std::string& qStart,
+                     const std::string& qEnd, std::vector<uint32_t>& out) const;
 
     std::vector<std::string> query(const std::string& value,
                                    const std::string& qStart,
@@ -52,8 +157,53 @@ class BloomTree {
                                         const std::string& qStart,
                                         const std::string& qEnd) const;
 
+    // Runs all values through the tree together, level by level, so each
+    // node is probed for every live value while it is hot in cache.
+    // result[i] holds the candidate leaves for values[i].
+    std::vector<std::vector<const Node*>> queryBatch(
+        std::span<const std::string> values, const std::string& qStart,
+        const std::string& qEnd) const;
+
+    // Moves one key of column from oldValue to newValue in the counting
+    // filter of the leaf holding it, the partition of file (the SST the key
+    // lives in) covering key, and refreshes the bits of the leaf and its
+    // ancestors. Without such a leaf newValue is only added to a counting
+    // leaf covering key: oldValue stays, since removing it from a leaf that
+    // never held it would drop other values. Returns false if no counting
+    // leaf covers key, i.e. newValue is not indexed.
+    // Copy-on-write: the root-to-leaf path is copied into storage of this
+    // tree alone, leaving other copies (a published version) as they were;
+    // publish this tree once its updates are in.
+    bool applyValueUpdate(const std::string& column, const std::string& key,
+                          const std::string& oldValue, const std::string& newValue,
+                          const std::string& file);
+
+    // Packed bytes of the internal bloom filters
     size_t memorySize() const;
     size_t diskSize() const;
+    // Walks the tree in memory; set bits are counted once per node and cached
+    TreeStats stats() const;
+    // Bytes of the leaf filters held in memory (static filters, resident
+    // Bloom bits and the pages cached for paged-out leaves)
+    size_t leafMemorySize() const;
+    // Level sizes, sampled FPPs and rows per leaf, as of the last build
+    const TreeProfile& profile() const { return storage->profile; }
+
+    // Copy whose internal filters are folded until they fit internalBytes,
+    // sharing the leaves with this tree. Whole levels are folded, the one
+    // whose FPP stays lowest first, and never below the level above, so
+    // a parent still covers its children. Build it off to the side and
+    // publish it in place of this tree.
+    BloomTree foldedToBudget(size_t internalBytes) const;
+
+    // Tiered mode: drops the bits of every plain Bloom leaf from memory and
+    // probes them from the segment through an LRU of cacheBytes. Internal
+    // nodes stay resident. Counting and static-filter leaves are kept as is.
+    // Parents of paged leaves lose their child slices. Needs a tree built
+    // with a segment.
+    void pageOutLeaves(size_t cacheBytes);
+    const LeafFilterCache* leafCache() const { return storage->leafCache.get(); }
+    const LeafSegment* segment() const { return storage->segment.get(); }
 
     void print() const {
         root->print();
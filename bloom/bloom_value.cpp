@@ -1,6 +1,6 @@
 #include "bloom_value.hpp"
+#include <bit>
 #include <iostream>
-
 #include <stdexcept>
 
 #include "MurmurHash3.h"
@@ -9,11 +9,11 @@
 //     double ln2 = std::log(2.0);
 //     bitArraySize = static_cast<size_t>(-(expectedItems * std::log(falsePositiveRate)) / (ln2 * ln2));
 //     numHashFunctions = static_cast<int>(std::round((bitArraySize / expectedItems) * ln2));
-//     bitArray.resize(bitArraySize, false);
+//     bitWords.assign(wordCount(bitArraySize), 0);
 // }
 
 BloomFilter::BloomFilter(size_t size, double numHashFunctions) : bitArraySize(size), numHashFunctions(numHashFunctions) {
-    bitArray.resize(bitArraySize, false);
+    bitWords.assign(wordCount(bitArraySize), 0);
 }
 
 size_t BloomFilter::hash(const std::string& key, int seed) const {
@@ -24,13 +24,28 @@ size_t BloomFilter::hash(const std::string& key, int seed) const {
 
 void BloomFilter::insert(const std::string& key) {
     for (int i = 0; i < numHashFunctions; ++i) {
-        bitArray[hash(key, i)] = true;
+        set(hash(key, i));
     }
 }
 
 bool BloomFilter::exists(const std::string& key) const {
     for (int i = 0; i < numHashFunctions; ++i) {
-        if (!bitArray[hash(key, i)]) {
+        if (!test(hash(key, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BloomFilter::computeHashes(const std::string& key, uint32_t* out) const {
+    for (int i = 0; i < numHashFunctions; ++i) {
+        MurmurHash3_x86_32(key.c_str(), key.size(), i, &out[i]);
+    }
+}
+
+bool BloomFilter::existsHashes(const uint32_t* hashes) const {
+    for (int i = 0; i < numHashFunctions; ++i) {
+        if (!test(static_cast<size_t>(hashes[i]) % bitArraySize)) {
             return false;
         }
     }
@@ -38,14 +53,75 @@ bool BloomFilter::exists(const std::string& key) const {
 }
 
 void BloomFilter::merge(const BloomFilter& other) {
-    if (bitArray.size() != other.bitArray.size()) {
-      std::cout << "bitArray.size() " << bitArray.size() << " other.bitArray.size() " << other.bitArray.size() << std::endl;
+    if (bitArraySize != other.bitArraySize || bitWords.size() != other.bitWords.size()) {
+      std::cout << "bitArraySize " << bitArraySize << " other.bitArraySize " << other.bitArraySize << std::endl;
 
         throw std::runtime_error("BloomFilter size mismatch during merge");
     }
-    for (size_t i = 0; i < bitArray.size(); ++i) {
-        bitArray[i] = bitArray[i] | other.bitArray[i];
+    for (size_t w = 0; w < bitWords.size(); ++w) {
+        bitWords[w] |= other.bitWords[w];
+    }
+}
+
+void BloomFilter::fold() {
+    if (!foldable()) throw std::runtime_error("BloomFilter size is not a power of two, cannot fold");
+    size_t half = bitArraySize / 2;
+    if (half % 64 == 0) {
+        size_t halfWords = half / 64;
+        for (size_t w = 0; w < halfWords; ++w) bitWords[w] |= bitWords[w + halfWords];
+    } else {
+        for (size_t i = 0; i < half; ++i) {
+            if (test(i + half)) set(i);
+        }
     }
+    bitWords.resize(wordCount(half));
+    if (half % 64) bitWords.back() &= (uint64_t{1} << (half % 64)) - 1;
+    bitWords.shrink_to_fit();
+    bitArraySize = half;
+}
+
+void BloomFilter::mergeFolded(const BloomFilter& other) {
+    if (other.bitArraySize == bitArraySize) {
+        merge(other);
+        return;
+    }
+    if (!foldable() || !other.foldable() || other.bitArraySize < bitArraySize) {
+        throw std::runtime_error("BloomFilter sizes cannot be folded together");
+    }
+    if (bitArraySize % 64 == 0) {
+        // Word w of other lands on word w % size of this one
+        for (size_t w = 0; w < other.bitWords.size(); ++w) {
+            bitWords[w % bitWords.size()] |= other.bitWords[w];
+        }
+        return;
+    }
+    for (size_t i = 0; i < other.bitArraySize; ++i) {
+        if (other.test(i)) set(i & (bitArraySize - 1));
+    }
+}
+
+bool BloomFilter::anyFoldedBit(size_t pos, size_t foldedSize) const {
+    for (size_t i = pos % foldedSize; i < bitArraySize; i += foldedSize) {
+        if (test(i)) return true;
+    }
+    return false;
+}
+
+size_t BloomFilter::countSetBits() const {
+    // Bits past bitArraySize are kept clear, so whole words can be counted
+    size_t count = 0;
+    for (uint64_t word : bitWords) {
+        count += static_cast<size_t>(std::popcount(word));
+    }
+    return count;
+}
+
+double BloomFilter::estimateCardinality(size_t setBits) const {
+    if (bitArraySize == 0 || numHashFunctions == 0) return 0.0;
+    // n ~ -(m / k) * ln(1 - X / m); a saturated filter is clamped to m
+    if (setBits >= bitArraySize) return static_cast<double>(bitArraySize);
+    double m = static_cast<double>(bitArraySize);
+    return -(m / numHashFunctions) * std::log(1.0 - static_cast<double>(setBits) / m);
 }
 
 void BloomFilter::saveToFile(const std::string& filename) const {
@@ -58,7 +134,7 @@ void BloomFilter::saveToFile(const std::string& filename) const {
     size_t byteSize = (bitArraySize + 7) / 8;
     std::vector<char> buffer(byteSize, 0);
     for (size_t i = 0; i < bitArraySize; ++i) {
-        if (bitArray[i]) buffer[i / 8] |= (1 << (i % 8));
+        if (test(i)) buffer[i / 8] |= (1 << (i % 8));
     }
     file.write(buffer.data(), buffer.size());
 }
@@ -75,14 +151,14 @@ BloomFilter BloomFilter::loadFromFile(const std::string& filename) {
     BloomFilter filter(1, 0.01);  // Temporary dummy values
     filter.bitArraySize = bitArraySize;
     filter.numHashFunctions = numHashFunctions;
-    filter.bitArray.resize(bitArraySize);
+    filter.bitWords.assign(wordCount(bitArraySize), 0);
 
     size_t byteSize = (bitArraySize + 7) / 8;
     std::vector<char> buffer(byteSize);
     file.read(buffer.data(), buffer.size());
 
     for (size_t i = 0; i < bitArraySize; ++i) {
-        filter.bitArray[i] = buffer[i / 8] & (1 << (i % 8));
+        filter.assign(i, buffer[i / 8] & (1 << (i % 8)));
     }
 
     return filter;
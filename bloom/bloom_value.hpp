@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -10,16 +11,50 @@ class BloomFilter {
     size_t hash(const std::string& key, int seed) const;
 
    public:
-    std::vector<bool> bitArray;
+    // Filter bits, 64 per word (bit p is bit p % 64 of word p / 64); bits
+    // past bitArraySize stay clear. Empty while the bits are paged out.
+    std::vector<uint64_t> bitWords;
     int numHashFunctions;
     size_t bitArraySize;
+
+    static size_t wordCount(size_t bits) { return (bits + 63) / 64; }
+    bool test(size_t pos) const { return (bitWords[pos >> 6] >> (pos & 63)) & 1; }
+    void set(size_t pos) { bitWords[pos >> 6] |= uint64_t{1} << (pos & 63); }
+    void assign(size_t pos, bool bit) {
+        if (bit) {
+            set(pos);
+        } else {
+            bitWords[pos >> 6] &= ~(uint64_t{1} << (pos & 63));
+        }
+    }
+    // Whether the bits are held in memory
+    bool resident() const { return bitWords.size() == wordCount(bitArraySize); }
+    void releaseBits() { std::vector<uint64_t>().swap(bitWords); }
     //  for future use
     // BloomFilter(size_t expectedItems, double falsePositiveRate);
     BloomFilter(size_t size, double numHashFunctions);
     void insert(const std::string& key);
     bool exists(const std::string& key) const;
+    // Raw per-seed hashes of key, reusable across filters with the same
+    // numHashFunctions (positions are reduced modulo each filter's size)
+    void computeHashes(const std::string& key, uint32_t* out) const;
+    bool existsHashes(const uint32_t* hashes) const;
     void merge(const BloomFilter& other);
 
+    // Folding: with a power-of-two size, position h % m of a key becomes
+    // h % (m / 2) once the upper half is OR-ed onto the lower one, so the
+    // halved filter answers for the same keys without rehashing them.
+    bool foldable() const { return bitArraySize >= 2 && (bitArraySize & (bitArraySize - 1)) == 0; }
+    void fold();
+    // OR of other into this; a larger other is folded down on the fly
+    void mergeFolded(const BloomFilter& other);
+    // Whether any bit of this filter folds onto pos of a foldedSize filter
+    bool anyFoldedBit(size_t pos, size_t foldedSize) const;
+
+    size_t countSetBits() const;
+    // Estimated number of distinct items inserted, from the number of set bits
+    double estimateCardinality(size_t setBits) const;
+
     void saveToFile(const std::string& filename) const;
     static BloomFilter loadFromFile(const std::string& filename);
 };
@@ -0,0 +1,96 @@
+#include "child_slices.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "MurmurHash3.h"
+
+ChildSlices::ChildSlices(const std::vector<const BloomFilter*>& children) {
+    if (children.empty() || children.size() > kMaxChildren) {
+        throw std::runtime_error("ChildSlices takes 1 to 64 children");
+    }
+    bits_ = children.front()->bitArraySize;
+    numHashFunctions = children.front()->numHashFunctions;
+    width = children.size() <= 8 ? 1 : children.size() <= 16 ? 2 : children.size() <= 32 ? 4 : 8;
+    allChildren = children.size() == 64 ? ~uint64_t{0} : (uint64_t{1} << children.size()) - 1;
+    words.assign(bits_ * width, 0);
+    for (size_t c = 0; c < children.size(); ++c) {
+        const BloomFilter* child = children[c];
+        if (child->bitArraySize != bits_ || !child->resident() ||
+            child->numHashFunctions != numHashFunctions) {
+            throw std::runtime_error("ChildSlices needs resident children of one size");
+        }
+        for (size_t p = 0; p < bits_; ++p) {
+            if (child->test(p)) storeWord(p, word(p) | (uint64_t{1} << c));
+        }
+    }
+}
+
+uint64_t ChildSlices::word(size_t pos) const {
+    const uint8_t* at = &words[pos * width];
+    switch (width) {
+        case 1:
+            return *at;
+        case 2: {
+            uint16_t w;
+            std::memcpy(&w, at, sizeof(w));
+            return w;
+        }
+        case 4: {
+            uint32_t w;
+            std::memcpy(&w, at, sizeof(w));
+            return w;
+        }
+        default: {
+            uint64_t w;
+            std::memcpy(&w, at, sizeof(w));
+            return w;
+        }
+    }
+}
+
+void ChildSlices::storeWord(size_t pos, uint64_t value) {
+    uint8_t* at = &words[pos * width];
+    switch (width) {
+        case 1:
+            *at = static_cast<uint8_t>(value);
+            break;
+        case 2: {
+            uint16_t w = static_cast<uint16_t>(value);
+            std::memcpy(at, &w, sizeof(w));
+            break;
+        }
+        case 4: {
+            uint32_t w = static_cast<uint32_t>(value);
+            std::memcpy(at, &w, sizeof(w));
+            break;
+        }
+        default:
+            std::memcpy(at, &value, sizeof(value));
+    }
+}
+
+uint64_t ChildSlices::mayContain(const uint32_t* hashes) const {
+    uint64_t mask = allChildren;
+    for (int i = 0; i < numHashFunctions && mask; ++i) {
+        mask &= word(static_cast<size_t>(hashes[i]) % bits_);
+    }
+    return mask;
+}
+
+uint64_t ChildSlices::mayContain(const std::string& value) const {
+    // Hashed one seed at a time, so a value no child holds stops early
+    uint64_t mask = allChildren;
+    for (int i = 0; i < numHashFunctions && mask; ++i) {
+        uint32_t hash;
+        MurmurHash3_x86_32(value.c_str(), value.size(), i, &hash);
+        mask &= word(static_cast<size_t>(hash) % bits_);
+    }
+    return mask;
+}
+
+void ChildSlices::set(size_t pos, size_t child, bool bit) {
+    uint64_t w = word(pos);
+    uint64_t mask = uint64_t{1} << child;
+    storeWord(pos, bit ? w | mask : w & ~mask);
+}
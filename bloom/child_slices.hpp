@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bloom_value.hpp"
+
+// Bit-sliced copy of the bloom filters of a node's children (BitFunnel
+// style): the word at position p holds bit p of every child, child c in bit
+// c. ANDing the words at a value's k positions tells which children may
+// contain it, with k loads instead of k per child. Words are 1 to 8 bytes,
+// the narrowest that fits the fanout.
+class ChildSlices {
+   public:
+    static constexpr size_t kMaxChildren = 64;
+
+    // All children resident and of one size and hash count
+    explicit ChildSlices(const std::vector<const BloomFilter*>& children);
+
+    // Bit c set if child c may contain the value; hashes as computed by
+    // BloomFilter::computeHashes
+    uint64_t mayContain(const uint32_t* hashes) const;
+    uint64_t mayContain(const std::string& value) const;
+
+    // Mirrors an in-place update of bit pos of one child
+    void set(size_t pos, size_t child, bool bit);
+
+    size_t bits() const { return bits_; }
+    size_t memorySize() const { return words.capacity(); }
+
+   private:
+    size_t bits_;
+    int numHashFunctions;
+    size_t width;
+    uint64_t allChildren;
+    std::vector<uint8_t> words;
+
+    uint64_t word(size_t pos) const;
+    void storeWord(size_t pos, uint64_t value);
+};
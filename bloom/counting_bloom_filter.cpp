@@ -0,0 +1,65 @@
+#include "counting_bloom_filter.hpp"
+
+#include "MurmurHash3.h"
+
+CountingBloomFilter::CountingBloomFilter(size_t size, int numHashFunctions)
+    : size(size), numHashFunctions(numHashFunctions), counters((size + 1) / 2, 0) {}
+
+void CountingBloomFilter::positions(const std::string& key, std::vector<size_t>& out) const {
+    out.clear();
+    for (int i = 0; i < numHashFunctions; ++i) {
+        uint32_t hashOutput;
+        MurmurHash3_x86_32(key.c_str(), key.size(), i, &hashOutput);
+        out.push_back(static_cast<size_t>(hashOutput) % size);
+    }
+}
+
+uint8_t CountingBloomFilter::counter(size_t pos) const {
+    uint8_t byte = counters[pos / 2];
+    return pos % 2 == 0 ? byte & 0x0F : byte >> 4;
+}
+
+void CountingBloomFilter::setCounter(size_t pos, uint8_t value) {
+    uint8_t& byte = counters[pos / 2];
+    byte = pos % 2 == 0 ? (byte & 0xF0) | value : (byte & 0x0F) | (value << 4);
+}
+
+std::vector<size_t> CountingBloomFilter::insert(const std::string& key) {
+    std::vector<size_t> pos;
+    positions(key, pos);
+    std::vector<size_t> raised;
+    for (size_t p : pos) {
+        uint8_t c = counter(p);
+        if (c == kMaxCount) continue;
+        if (c == 0) raised.push_back(p);
+        setCounter(p, c + 1);
+    }
+    return raised;
+}
+
+std::vector<size_t> CountingBloomFilter::remove(const std::string& key) {
+    std::vector<size_t> pos;
+    positions(key, pos);
+    std::vector<size_t> cleared;
+    for (size_t p : pos) {
+        if (counter(p) == 0) return cleared;
+    }
+    for (size_t p : pos) {
+        uint8_t c = counter(p);
+        // A key hashing twice to p was counted twice, so it is decremented
+        // twice; zero is only reachable when removing a false positive
+        if (c == kMaxCount || c == 0) continue;
+        if (c == 1) cleared.push_back(p);
+        setCounter(p, c - 1);
+    }
+    return cleared;
+}
+
+bool CountingBloomFilter::exists(const std::string& key) const {
+    std::vector<size_t> pos;
+    positions(key, pos);
+    for (size_t p : pos) {
+        if (counter(p) == 0) return false;
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bloom filter with 4-bit counters (two per byte) instead of bits, so values
+// can be removed. Positions match BloomFilter of the same size and hash
+// count, so a counter > 0 is exactly a set bit of the companion filter.
+// Counters saturate at 15 and then stay there, as usual, so an overflowed
+// position is never cleared.
+class CountingBloomFilter {
+   public:
+    CountingBloomFilter(size_t size, int numHashFunctions);
+
+    // Returns the positions whose counter went from zero to one
+    std::vector<size_t> insert(const std::string& key);
+    // Returns the positions whose counter dropped to zero; a key that is not
+    // present (some counter already zero) is left untouched
+    std::vector<size_t> remove(const std::string& key);
+    bool exists(const std::string& key) const;
+
+    uint8_t counter(size_t pos) const;
+    size_t memorySize() const { return counters.capacity(); }
+
+    size_t size;
+    int numHashFunctions;
+
+   private:
+    static constexpr uint8_t kMaxCount = 15;
+
+    std::vector<uint8_t> counters;
+
+    void positions(const std::string& key, std::vector<size_t>& out) const;
+    void setCounter(size_t pos, uint8_t value);
+};
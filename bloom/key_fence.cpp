@@ -0,0 +1,39 @@
+#include "key_fence.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+KeyFence KeyFence::of(std::string_view key) {
+    unsigned char bytes[kBytes] = {};
+    std::memcpy(bytes, key.data(), std::min(key.size(), kBytes));
+    KeyFence fence;
+    for (size_t w = 0; w < kWords; ++w) {
+        uint64_t word = 0;
+        for (size_t b = 0; b < 8; ++b) word = (word << 8) | bytes[w * 8 + b];
+        fence.words[w] = word;
+    }
+    return fence;
+}
+
+KeyFence KeyFence::max() {
+    KeyFence fence;
+    fence.words.fill(~uint64_t{0});
+    return fence;
+}
+
+ChildFences::ChildFences(const std::vector<KeyFence>& startFences, const std::vector<KeyFence>& endFences)
+    : starts(startFences) {
+    maxEnds.reserve(endFences.size());
+    for (size_t c = 0; c < endFences.size(); ++c) {
+        maxEnds.push_back(c == 0 ? endFences[c] : std::max(maxEnds.back(), endFences[c]));
+        if (c > 0 && starts[c] < starts[c - 1]) sorted = false;
+    }
+}
+
+std::pair<size_t, size_t> ChildFences::overlapRange(const KeyFence& lo, const KeyFence& hi) const {
+    if (!sorted) return {0, starts.size()};
+    // Children before first end below lo, children from last start above hi
+    size_t first = std::lower_bound(maxEnds.begin(), maxEnds.end(), lo) - maxEnds.begin();
+    size_t last = std::upper_bound(starts.begin(), starts.end(), hi) - starts.begin();
+    return {first, std::max(first, last)};
+}
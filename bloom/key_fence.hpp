@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// First kFenceBytes of a key as big-endian words, zero padded, so comparing
+// fences as integers orders keys like comparing the strings does. Only keys
+// that tie on the fence and run past it need the string compare.
+struct KeyFence {
+    static constexpr size_t kWords = 3;
+    static constexpr size_t kBytes = kWords * 8;
+
+    std::array<uint64_t, kWords> words{};
+
+    static KeyFence of(std::string_view key);
+    static KeyFence max();
+
+    friend auto operator<=>(const KeyFence&, const KeyFence&) = default;
+};
+
+// A key and its fence; key views a string that outlives the ref (a node's
+// key or a query bound)
+struct KeyRef {
+    KeyFence fence;
+    std::string_view key;
+
+    KeyRef() = default;
+    explicit KeyRef(std::string_view k) : fence(KeyFence::of(k)), key(k) {}
+    KeyRef(const KeyFence& f, std::string_view k) : fence(f), key(k) {}
+
+    friend std::strong_ordering operator<=>(const KeyRef& a, const KeyRef& b) {
+        if (auto c = a.fence <=> b.fence; c != 0) return c;
+        // Tied keys that fit in the fence differ only in zero padding
+        if (a.key.size() <= KeyFence::kBytes && b.key.size() <= KeyFence::kBytes) {
+            return a.key.size() <=> b.key.size();
+        }
+        return a.key.compare(b.key) <=> 0;
+    }
+    friend bool operator==(const KeyRef& a, const KeyRef& b) { return (a <=> b) == 0; }
+};
+
+// Fences of a node's children, which are kept in start-key order. The
+// starts and the running maximum of the ends are then both sorted, so two
+// binary searches bracket the children a key range can overlap.
+class ChildFences {
+   public:
+    ChildFences() = default;
+    ChildFences(const std::vector<KeyFence>& starts, const std::vector<KeyFence>& ends);
+
+    size_t size() const { return starts.size(); }
+
+    // Children [first, last) that may overlap [lo, hi]; none outside it
+    // does, the ones inside still need the exact test
+    std::pair<size_t, size_t> overlapRange(const KeyFence& lo, const KeyFence& hi) const;
+
+   private:
+    std::vector<KeyFence> starts;
+    std::vector<KeyFence> maxEnds;
+    // False if the children were not in start order; every child is then
+    // in range
+    bool sorted = true;
+};
@@ -0,0 +1,83 @@
+#include "leaf_cache.hpp"
+
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+extern boost::asio::thread_pool globalThreadPool;
+
+LeafFilterCache::LeafFilterCache(std::shared_ptr<const LeafSegment> segment, size_t capacityBytes,
+                                 size_t siblingGroup)
+    : segment(std::move(segment)), capacity(capacityBytes), siblingGroup(std::max<size_t>(1, siblingGroup)) {}
+
+void LeafFilterCache::insertLocked(uint32_t slot, std::shared_ptr<const BloomFilter> filter) {
+    if (resident.count(slot)) return;
+    lru.push_front(slot);
+    resident.emplace(slot, Entry{std::move(filter), lru.begin()});
+    residentTotal += segment->record(slot).bytes;
+    // The newest entry always stays, even if it alone exceeds the budget
+    while (residentTotal > capacity && lru.size() > 1) {
+        residentTotal -= segment->record(lru.back()).bytes;
+        resident.erase(lru.back());
+        lru.pop_back();
+    }
+}
+
+std::shared_ptr<const BloomFilter> LeafFilterCache::get(uint32_t slot) {
+    {
+        std::lock_guard lock(mutex);
+        auto it = resident.find(slot);
+        if (it != resident.end()) {
+            lru.splice(lru.begin(), lru, it->second.lruPos);
+            ++hitCount;
+            ++gLeafCacheHitCount;
+            return it->second.filter;
+        }
+    }
+    ++missCount;
+    ++gLeafCacheMissCount;
+    auto filter = std::make_shared<const BloomFilter>(segment->read(slot));
+    {
+        std::lock_guard lock(mutex);
+        insertLocked(slot, filter);
+    }
+    uint32_t first = static_cast<uint32_t>(slot / siblingGroup * siblingGroup);
+    prefetch(first, static_cast<uint32_t>(std::min(segment->size(), first + siblingGroup)));
+    return filter;
+}
+
+void LeafFilterCache::prefetch(uint32_t first, uint32_t last) {
+    std::vector<uint32_t> missing;
+    {
+        std::lock_guard lock(mutex);
+        for (uint32_t slot = first; slot < last; ++slot) {
+            if (!resident.count(slot) && inFlight.insert(slot).second) missing.push_back(slot);
+        }
+    }
+    if (missing.empty()) return;
+
+    std::weak_ptr<LeafFilterCache> weak = weak_from_this();
+    boost::asio::post(globalThreadPool, [weak, missing = std::move(missing)]() {
+        auto self = weak.lock();
+        if (!self) return;
+        std::vector<BloomFilter> filters;
+        try {
+            // Sibling records are adjacent in the segment: one read for all
+            filters = self->segment->readBatch(missing);
+        } catch (const std::exception&) {
+            // A failed prefetch just leaves the slots to the next get()
+        }
+        std::lock_guard lock(self->mutex);
+        for (size_t i = 0; i < missing.size(); ++i) {
+            self->inFlight.erase(missing[i]);
+            if (i < filters.size()) {
+                self->insertLocked(missing[i], std::make_shared<const BloomFilter>(std::move(filters[i])));
+            }
+        }
+    });
+}
+
+size_t LeafFilterCache::residentBytes() const {
+    std::lock_guard lock(mutex);
+    return residentTotal;
+}
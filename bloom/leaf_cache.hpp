@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bloom_value.hpp"
+#include "leaf_segment.hpp"
+
+extern std::atomic<size_t> gLeafCacheHitCount;   // declared in algorithm.hpp
+extern std::atomic<size_t> gLeafCacheMissCount;  // declared in algorithm.hpp
+
+// Leaf bloom filters of one tree read back on demand from its LeafSegment.
+// A byte-bounded LRU keeps the recently probed ones in memory.
+class LeafFilterCache : public std::enable_shared_from_this<LeafFilterCache> {
+   public:
+    // siblingGroup is the number of leaves under one parent
+    LeafFilterCache(std::shared_ptr<const LeafSegment> segment, size_t capacityBytes, size_t siblingGroup);
+
+    LeafFilterCache(const LeafFilterCache&) = delete;
+    LeafFilterCache& operator=(const LeafFilterCache&) = delete;
+
+    // Reads the filter on a miss and prefetches the rest of its sibling
+    // group in the background: a parent that passed tends to have more
+    // passing children, and range scans walk siblings in order.
+    std::shared_ptr<const BloomFilter> get(uint32_t slot);
+    // Loads [first, last) slots that are not resident on globalThreadPool
+    void prefetch(uint32_t first, uint32_t last);
+
+    size_t capacityBytes() const { return capacity; }
+    size_t residentBytes() const;
+    uint64_t hits() const { return hitCount.load(); }
+    uint64_t misses() const { return missCount.load(); }
+
+   private:
+    struct Entry {
+        std::shared_ptr<const BloomFilter> filter;
+        std::list<uint32_t>::iterator lruPos;
+    };
+
+    std::shared_ptr<const LeafSegment> segment;
+    size_t capacity;
+    size_t siblingGroup;
+
+    mutable std::mutex mutex;
+    std::list<uint32_t> lru;  // most recently used first
+    std::unordered_map<uint32_t, Entry> resident;
+    std::unordered_set<uint32_t> inFlight;
+    size_t residentTotal = 0;
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> missCount{0};
+
+    // Caller holds mutex
+    void insertLocked(uint32_t slot, std::shared_ptr<const BloomFilter> filter);
+};
@@ -0,0 +1,48 @@
+#include "leaf_filter.hpp"
+
+#include <algorithm>
+
+#include "MurmurHash3.h"
+#include "binary_fuse_filter.hpp"
+#include "ribbon_filter.hpp"
+
+const char* leafFilterTypeName(LeafFilterType type) {
+    switch (type) {
+        case LeafFilterType::Bloom:
+            return "Bloom";
+        case LeafFilterType::BinaryFuse8:
+            return "BinaryFuse8";
+        case LeafFilterType::BinaryFuse16:
+            return "BinaryFuse16";
+        case LeafFilterType::Ribbon8:
+            return "Ribbon8";
+        case LeafFilterType::Ribbon16:
+            return "Ribbon16";
+    }
+    return "Unknown";
+}
+
+uint64_t leafFilterKeyHash(std::string_view value) {
+    uint64_t hashOutput[2];
+    MurmurHash3_x64_128(value.data(), static_cast<int>(value.size()), 0, hashOutput);
+    return hashOutput[0];
+}
+
+std::unique_ptr<LeafFilter> makeLeafFilter(LeafFilterType type, std::vector<uint64_t>& keyHashes) {
+    if (type == LeafFilterType::Bloom) return nullptr;
+    std::sort(keyHashes.begin(), keyHashes.end());
+    keyHashes.erase(std::unique(keyHashes.begin(), keyHashes.end()), keyHashes.end());
+    switch (type) {
+        case LeafFilterType::Bloom:
+            return nullptr;
+        case LeafFilterType::BinaryFuse8:
+            return std::make_unique<BinaryFuseFilter<uint8_t>>(keyHashes);
+        case LeafFilterType::BinaryFuse16:
+            return std::make_unique<BinaryFuseFilter<uint16_t>>(keyHashes);
+        case LeafFilterType::Ribbon8:
+            return std::make_unique<RibbonFilter<uint8_t>>(keyHashes);
+        case LeafFilterType::Ribbon16:
+            return std::make_unique<RibbonFilter<uint16_t>>(keyHashes);
+    }
+    return nullptr;
+}
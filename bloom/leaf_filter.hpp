@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+enum class LeafFilterType { Bloom, BinaryFuse8, BinaryFuse16, Ribbon8, Ribbon16 };
+
+const char* leafFilterTypeName(LeafFilterType type);
+
+// Static membership filter over the values of one leaf partition. Leaves are
+// still built with a BloomFilter, which their parents merge; a LeafFilter
+// replaces it for probing once the tree is built.
+class LeafFilter {
+   public:
+    virtual ~LeafFilter() = default;
+    virtual bool contains(std::string_view value) const = 0;
+    virtual size_t memorySize() const = 0;
+    virtual double falsePositiveRate() const = 0;
+    virtual LeafFilterType type() const = 0;
+};
+
+// 64-bit hash of a value, the key every static leaf filter is built from
+uint64_t leafFilterKeyHash(std::string_view value);
+
+// Finalizer of MurmurHash3; rehashes a key hash under a filter's seed
+inline uint64_t leafFilterMix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Builds a filter of the given type from the key hashes of one partition
+// (deduplicated in place). Returns null for LeafFilterType::Bloom.
+std::unique_ptr<LeafFilter> makeLeafFilter(LeafFilterType type, std::vector<uint64_t>& keyHashes);
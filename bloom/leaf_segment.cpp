@@ -0,0 +1,185 @@
+#include "leaf_segment.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+
+#include "MurmurHash3.h"
+
+namespace {
+
+constexpr uint32_t kChecksumSeed = 0x5eed1eaf;
+
+uint32_t checksumOf(const char* data, size_t bytes) {
+    uint32_t hash;
+    MurmurHash3_x86_32(data, static_cast<int>(bytes), kChecksumSeed, &hash);
+    return hash;
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void writeAll(int fd, const char* data, size_t bytes, const std::string& path) {
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, data, bytes);
+        if (n <= 0) throw std::runtime_error("Write to leaf segment failed: " + path);
+        data += n;
+        bytes -= static_cast<size_t>(n);
+    }
+}
+
+void readAll(int fd, char* data, size_t bytes, uint64_t offset, const std::string& path) {
+    while (bytes > 0) {
+        ssize_t n = ::pread(fd, data, bytes, static_cast<off_t>(offset));
+        if (n <= 0) throw std::runtime_error("Read from leaf segment failed: " + path);
+        data += n;
+        bytes -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<LeafSegment> LeafSegment::create(const std::string& path,
+                                                 const std::vector<const BloomFilter*>& filters) {
+    std::shared_ptr<LeafSegment> segment(new LeafSegment(path));
+    segment->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (segment->fd == -1) throw std::runtime_error("Cannot create leaf segment: " + path);
+    segment->ownsFile = true;
+
+    std::vector<char> batch;
+    uint64_t flushed = 0;
+    auto flush = [&]() {
+        writeAll(segment->fd, batch.data(), batch.size(), path);
+        flushed += batch.size();
+        batch.clear();
+    };
+
+    segment->records.reserve(filters.size());
+    for (const BloomFilter* bf : filters) {
+        Record rec{};
+        rec.offset = flushed + batch.size();
+        rec.bits = bf->bitArraySize;
+        rec.bytes = (bf->bitArraySize + 7) / 8;
+        rec.numHashFunctions = static_cast<uint32_t>(bf->numHashFunctions);
+
+        size_t begin = batch.size();
+        batch.resize(begin + alignUp(rec.bytes, kAlignment), 0);
+        char* out = batch.data() + begin;
+        for (size_t i = 0; i < bf->bitArraySize; ++i) {
+            if (bf->test(i)) out[i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+        rec.checksum = checksumOf(out, rec.bytes);
+        segment->records.push_back(rec);
+
+        if (batch.size() >= kWriteBatchBytes) flush();
+    }
+
+    Footer footer{};
+    footer.tableOffset = flushed + batch.size();
+    footer.recordCount = segment->records.size();
+    footer.magic = kMagic;
+    footer.version = kVersion;
+    const char* table = reinterpret_cast<const char*>(segment->records.data());
+    size_t tableBytes = segment->records.size() * sizeof(Record);
+    footer.tableChecksum = checksumOf(table, tableBytes);
+    batch.insert(batch.end(), table, table + tableBytes);
+    const char* footerBytes = reinterpret_cast<const char*>(&footer);
+    batch.insert(batch.end(), footerBytes, footerBytes + sizeof(Footer));
+    flush();
+
+    segment->totalBytes = flushed;
+    return segment;
+}
+
+std::shared_ptr<LeafSegment> LeafSegment::open(const std::string& path) {
+    std::shared_ptr<LeafSegment> segment(new LeafSegment(path));
+    segment->fd = ::open(path.c_str(), O_RDONLY);
+    if (segment->fd == -1) throw std::runtime_error("Cannot open leaf segment: " + path);
+
+    off_t end = ::lseek(segment->fd, 0, SEEK_END);
+    if (end < static_cast<off_t>(sizeof(Footer))) {
+        throw std::runtime_error("Leaf segment too short: " + path);
+    }
+    Footer footer;
+    readAll(segment->fd, reinterpret_cast<char*>(&footer), sizeof(Footer),
+            static_cast<uint64_t>(end) - sizeof(Footer), path);
+    if (footer.magic != kMagic || footer.version != kVersion) {
+        throw std::runtime_error("Not a leaf segment: " + path);
+    }
+    size_t tableBytes = footer.recordCount * sizeof(Record);
+    if (footer.tableOffset + tableBytes + sizeof(Footer) != static_cast<uint64_t>(end)) {
+        throw std::runtime_error("Leaf segment table out of bounds: " + path);
+    }
+    segment->records.resize(footer.recordCount);
+    readAll(segment->fd, reinterpret_cast<char*>(segment->records.data()), tableBytes,
+            footer.tableOffset, path);
+    if (checksumOf(reinterpret_cast<const char*>(segment->records.data()), tableBytes) !=
+        footer.tableChecksum) {
+        throw std::runtime_error("Leaf segment table checksum mismatch: " + path);
+    }
+    segment->totalBytes = static_cast<size_t>(end);
+    return segment;
+}
+
+LeafSegment::~LeafSegment() {
+    if (fd != -1) ::close(fd);
+    if (ownsFile) std::remove(filePath.c_str());
+}
+
+BloomFilter LeafSegment::decode(uint32_t slot, const char* data) const {
+    const Record& rec = records[slot];
+    if (checksumOf(data, rec.bytes) != rec.checksum) {
+        throw std::runtime_error("Leaf segment record " + std::to_string(slot) +
+                                 " checksum mismatch: " + filePath);
+    }
+    BloomFilter filter(rec.bits, rec.numHashFunctions);
+    for (size_t i = 0; i < rec.bits; ++i) {
+        filter.assign(i, data[i / 8] & (1 << (i % 8)));
+    }
+    return filter;
+}
+
+BloomFilter LeafSegment::read(uint32_t slot) const {
+    const Record& rec = records.at(slot);
+    std::vector<char> buffer(rec.bytes);
+    readAll(fd, buffer.data(), rec.bytes, rec.offset, filePath);
+    return decode(slot, buffer.data());
+}
+
+std::vector<BloomFilter> LeafSegment::readBatch(std::span<const uint32_t> slots) const {
+    std::vector<size_t> order(slots.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return records.at(slots[a]).offset < records.at(slots[b]).offset;
+    });
+
+    std::vector<BloomFilter> result(slots.size(), BloomFilter(0, 0));
+    std::vector<char> buffer;
+    for (size_t i = 0; i < order.size();) {
+        // Extend the run while the next record follows within the read budget
+        uint64_t begin = records[slots[order[i]]].offset;
+        uint64_t end = begin + records[slots[order[i]]].bytes;
+        size_t j = i + 1;
+        while (j < order.size()) {
+            const Record& next = records[slots[order[j]]];
+            uint64_t nextEnd = next.offset + next.bytes;
+            if (next.offset > alignUp(end, kAlignment) || nextEnd - begin > kReadBatchBytes) break;
+            end = std::max(end, nextEnd);
+            ++j;
+        }
+        buffer.resize(end - begin);
+        readAll(fd, buffer.data(), buffer.size(), begin, filePath);
+        for (size_t r = i; r < j; ++r) {
+            uint32_t slot = slots[order[r]];
+            result[order[r]] = decode(slot, buffer.data() + (records[slot].offset - begin));
+        }
+        i = j;
+    }
+    return result;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bloom_value.hpp"
+
+// Leaf bloom filters of one tree in a single append-only file. Records are
+// the packed filter bits, each starting on a kAlignment boundary; the offset
+// table and a footer follow the last record:
+//
+//   record 0 | pad | record 1 | pad | ... | table | footer
+//
+// Every record and the table carry a MurmurHash3 checksum that is verified
+// on read. A segment removes the file it created when it is destroyed.
+class LeafSegment {
+   public:
+    static constexpr size_t kAlignment = 4096;
+    // Pending records are written in batches of about this size
+    static constexpr size_t kWriteBatchBytes = 4 << 20;
+    // Adjacent records are coalesced into reads of at most this size
+    static constexpr size_t kReadBatchBytes = 4 << 20;
+
+    struct Record {
+        uint64_t offset;
+        uint64_t bytes;
+        uint64_t bits;
+        uint32_t numHashFunctions;
+        uint32_t checksum;
+    };
+
+    // Writes filters to path in order (slot i = filters[i]) and keeps the
+    // file open for reads
+    static std::shared_ptr<LeafSegment> create(const std::string& path,
+                                               const std::vector<const BloomFilter*>& filters);
+    // Opens a segment written by create(), checking its footer and table
+    static std::shared_ptr<LeafSegment> open(const std::string& path);
+
+    ~LeafSegment();
+    LeafSegment(const LeafSegment&) = delete;
+    LeafSegment& operator=(const LeafSegment&) = delete;
+
+    BloomFilter read(uint32_t slot) const;
+    // Reads several slots with as few preads as possible; result[i] is slots[i]
+    std::vector<BloomFilter> readBatch(std::span<const uint32_t> slots) const;
+
+    size_t size() const { return records.size(); }
+    const Record& record(uint32_t slot) const { return records.at(slot); }
+    // Whole file: records, padding, table and footer
+    size_t fileBytes() const { return totalBytes; }
+    const std::string& path() const { return filePath; }
+
+   private:
+    struct Footer {
+        uint64_t tableOffset;
+        uint64_t recordCount;
+        uint64_t magic;
+        uint32_t version;
+        uint32_t tableChecksum;
+    };
+    static constexpr uint64_t kMagic = 0x4745534d4f4f4c42ULL;  // "BLOOMSEG"
+    static constexpr uint32_t kVersion = 1;
+
+    explicit LeafSegment(std::string path) : filePath(std::move(path)) {}
+
+    BloomFilter decode(uint32_t slot, const char* data) const;
+
+    std::string filePath;
+    int fd = -1;
+    bool ownsFile = false;
+    std::vector<Record> records;
+    size_t totalBytes = 0;
+};
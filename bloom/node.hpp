@@ -6,6 +6,14 @@
 #include <vector>
 
 #include "bloom_value.hpp"
+#include "child_slices.hpp"
+#include "counting_bloom_filter.hpp"
+#include "key_fence.hpp"
+#include "leaf_cache.hpp"
+#include "leaf_filter.hpp"
+#include "partition_index.hpp"
+
+enum class NodeKind : uint8_t { Leaf, Internal };
 
 class Node {
    public:
@@ -14,12 +22,87 @@ class Node {
     std::string filename;
     std::string startKey;
     std::string endKey;
+    // Fences of startKey and endKey; refresh with updateFences() after
+    // changing the keys
+    KeyFence startFence;
+    KeyFence endFence;
+    // Fences of the children's key ranges (internal nodes only)
+    ChildFences childFences;
+    // Set bits of the bloom filter, counted when the node is built and
+    // recounted by whoever changes the bits (refreshSetBits), so concurrent
+    // readers never write it. Kept when paged-out bits are released.
+    size_t setBitCount = 0;
+    // Optional value -> row run index of a leaf partition (null if not built)
+    std::shared_ptr<const PartitionIndex> valueIndex;
+    // Static filter probed instead of the bloom filter of a leaf (null if
+    // the leaf is a plain Bloom leaf)
+    std::shared_ptr<const LeafFilter> leafFilter;
+    // Counters behind the bloom bits of a leaf that takes in-place updates
+    std::shared_ptr<CountingBloomFilter> counting;
+    // Column family of a leaf updated in place; its SST file is stale then,
+    // so scans read the column over the leaf's key range instead
+    std::string liveColumn;
+    // Slot of the leaf's bloom bits in the tree's LeafSegment (-1 if none)
+    int32_t segmentSlot = -1;
+    // Set when the leaf's bloom bits are paged out; they are then read
+    // through the cache from segmentSlot
+    std::shared_ptr<LeafFilterCache> pagedBits;
+    // Internal node whose filter is saturated: queries descend through it
+    // without probing. Set at build time only; in-place updates may leave it
+    // stale, which costs pruning but never a match.
+    bool passThrough = false;
+    // Bit-sliced copy of the children's filters, probed instead of each
+    // child (null unless the tree is built with child slices)
+    std::shared_ptr<ChildSlices> childSlices;
+    // Fixed at construction: internal nodes are the ones named "Memory", so
+    // traversals test this instead of comparing filenames
+    NodeKind kind = NodeKind::Leaf;
+    // Position in the tree's leaf list (leaves only)
+    uint32_t leafIndex = 0;
 
     Node(BloomFilter bf, std::string fname, std::string start, std::string end)
-        : bloom(std::move(bf)), filename(std::move(fname)), startKey(std::move(start)), endKey(std::move(end)) {}
+        : bloom(std::move(bf)), filename(std::move(fname)), startKey(std::move(start)), endKey(std::move(end)) {
+        if (filename == "Memory") kind = NodeKind::Internal;
+        updateFences();
+        refreshSetBits();
+    }
 
     Node(size_t bloomSize, double falsePositiveRate)
-        : filename("Memory"), bloom(bloomSize, falsePositiveRate) {}
+        : filename("Memory"), bloom(bloomSize, falsePositiveRate), kind(NodeKind::Internal) {}
+
+    bool isLeaf() const { return kind == NodeKind::Leaf; }
+
+    KeyRef startRef() const { return {startFence, startKey}; }
+    KeyRef endRef() const { return {endFence, endKey}; }
+
+    void updateFences() {
+        startFence = KeyFence::of(startKey);
+        endFence = KeyFence::of(endKey);
+    }
+
+    size_t setBits() const { return setBitCount; }
+    void refreshSetBits() {
+        if (bloom.resident()) setBitCount = bloom.countSetBits();
+    }
+
+    bool mayContain(const std::string& value) const {
+        if (passThrough) return true;
+        if (leafFilter) return leafFilter->contains(value);
+        if (pagedBits) return pagedBits->get(segmentSlot)->exists(value);
+        return bloom.exists(value);
+    }
+
+    // mayContain from hashes computed once with BloomFilter::computeHashes
+    bool mayContainHashes(const std::string& value, const uint32_t* hashes) const {
+        if (passThrough) return true;
+        if (leafFilter) return leafFilter->contains(value);
+        if (pagedBits) return pagedBits->get(segmentSlot)->existsHashes(hashes);
+        return bloom.existsHashes(hashes);
+    }
+
+    double estimatedCardinality() const {
+        return bloom.estimateCardinality(setBits());
+    }
 
     void print() const {
         spdlog::info("Node: {}, Start: {}, End: {}", filename, startKey, endKey);
@@ -0,0 +1,68 @@
+#include "partition_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "MurmurHash3.h"
+
+namespace {
+// Bloom filters use seeds 0..k-1, keep the fingerprint independent of them
+constexpr uint32_t kFingerprintSeed = 0x9747b28c;
+}  // namespace
+
+uint32_t PartitionIndex::fingerprint(std::string_view value) {
+    uint32_t hashOutput;
+    MurmurHash3_x86_32(value.data(), static_cast<int>(value.size()), kFingerprintSeed, &hashOutput);
+    return hashOutput;
+}
+
+void PartitionIndex::Builder::add(std::string_view key, std::string_view value) {
+    if (rows % kRowsPerRun == 0) {
+        if (runStartKeys.size() >= kMaxRuns) {
+            throw std::runtime_error("Partition too large for PartitionIndex");
+        }
+        runStartKeys.emplace_back(key);
+    }
+    entries.emplace_back(fingerprint(value), static_cast<uint16_t>(runStartKeys.size() - 1));
+    rows++;
+}
+
+PartitionIndex PartitionIndex::Builder::build() {
+    std::sort(entries.begin(), entries.end());
+    // A value repeated within one run needs a single entry
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    PartitionIndex index;
+    index.fingerprints.reserve(entries.size());
+    index.runIds.reserve(entries.size());
+    for (const auto& [fp, run] : entries) {
+        index.fingerprints.push_back(fp);
+        index.runIds.push_back(run);
+    }
+    index.runStartKeys = std::move(runStartKeys);
+
+    entries.clear();
+    entries.shrink_to_fit();
+    runStartKeys.clear();
+    rows = 0;
+    return index;
+}
+
+std::vector<uint32_t> PartitionIndex::lookup(std::string_view value) const {
+    std::vector<uint32_t> runs;
+    uint32_t fp = fingerprint(value);
+    auto [first, last] = std::equal_range(fingerprints.begin(), fingerprints.end(), fp);
+    for (auto it = first; it != last; ++it) {
+        // Entries with equal fingerprints are sorted by run id
+        runs.push_back(runIds[it - fingerprints.begin()]);
+    }
+    return runs;
+}
+
+size_t PartitionIndex::memorySize() const {
+    size_t bytes = fingerprints.capacity() * sizeof(uint32_t) + runIds.capacity() * sizeof(uint16_t);
+    for (const auto& key : runStartKeys) {
+        bytes += sizeof(std::string) + key.capacity();
+    }
+    return bytes;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Value fingerprint -> row run map of one leaf partition. Rows are grouped in
+// runs of kRowsPerRun consecutive keys (about one SST data block) and only
+// the first key of each run is kept, so a bloom hit turns into a seek plus a
+// short scan per matching run. A value whose fingerprint is absent is not in
+// the partition; fingerprint collisions only cost an extra run scan.
+class PartitionIndex {
+   public:
+    static constexpr size_t kRowsPerRun = 64;
+    // Run ids are 16 bit, which caps a partition at kRowsPerRun * 65536 rows
+    static constexpr size_t kMaxRuns = size_t{1} << 16;
+
+    class Builder {
+       public:
+        // Rows must be added in key order, as read from the SST file
+        void add(std::string_view key, std::string_view value);
+        PartitionIndex build();
+
+       private:
+        std::vector<std::pair<uint32_t, uint16_t>> entries;
+        std::vector<std::string> runStartKeys;
+        size_t rows = 0;
+    };
+
+    // Ascending ids of the runs that may hold value; empty if it is absent
+    std::vector<uint32_t> lookup(std::string_view value) const;
+    const std::string& runStartKey(uint32_t run) const { return runStartKeys[run]; }
+    size_t runCount() const { return runStartKeys.size(); }
+    size_t memorySize() const;
+
+    static uint32_t fingerprint(std::string_view value);
+
+   private:
+    // Sorted by fingerprint, runIds[i] belongs to fingerprints[i]
+    std::vector<uint32_t> fingerprints;
+    std::vector<uint16_t> runIds;
+    std::vector<std::string> runStartKeys;
+};
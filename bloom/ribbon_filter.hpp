@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "leaf_filter.hpp"
+
+// Standard Ribbon filter (Dillinger & Walzer, 2021) with 64-bit coefficient
+// rows. Each key is one linear equation over GF(2): a 64-bit band of
+// coefficients starting at a hashed slot, whose product with the solution
+// must equal the key's fingerprint. Construction is on-the-fly Gaussian
+// elimination within the band plus back substitution, so it costs more than
+// a Bloom insert, but the filter needs only (1 + overhead) * bits per key.
+template <typename Fingerprint>
+class RibbonFilter : public LeafFilter {
+   public:
+    // keyHashes must be distinct
+    explicit RibbonFilter(const std::vector<uint64_t>& keyHashes) {
+        if (keyHashes.empty()) return;
+        double overhead = kInitialOverhead;
+        uint64_t seedState = 0x3c6ef372fe94f82bULL;
+        for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+            seedState += 0x9e3779b97f4a7c15ULL;
+            seed = leafFilterMix(seedState);
+            numSlots = std::max<size_t>(kBandWidth, static_cast<size_t>(std::ceil(keyHashes.size() * (1.0 + overhead))));
+            if (build(keyHashes)) return;
+            // Widen the system a little on every failed seed
+            overhead += kOverheadStep;
+        }
+        throw std::runtime_error("RibbonFilter construction failed");
+    }
+
+    bool contains(std::string_view value) const override {
+        if (solution.empty()) return false;
+        return containsHash(leafFilterKeyHash(value));
+    }
+
+    bool containsHash(uint64_t keyHash) const {
+        uint64_t hash = leafFilterMix(keyHash + seed);
+        uint64_t coeffs = coefficients(hash);
+        const Fingerprint* row = &solution[startSlot(hash)];
+        Fingerprint acc = 0;
+        while (coeffs) {
+            acc ^= row[std::countr_zero(coeffs)];
+            coeffs &= coeffs - 1;
+        }
+        return acc == fingerprintOf(hash);
+    }
+
+    size_t memorySize() const override {
+        return solution.capacity() * sizeof(Fingerprint) + sizeof(*this);
+    }
+
+    double falsePositiveRate() const override {
+        return std::ldexp(1.0, -static_cast<int>(8 * sizeof(Fingerprint)));
+    }
+
+    LeafFilterType type() const override {
+        return sizeof(Fingerprint) == 1 ? LeafFilterType::Ribbon8 : LeafFilterType::Ribbon16;
+    }
+
+   private:
+    static constexpr size_t kBandWidth = 64;
+    static constexpr double kInitialOverhead = 0.05;
+    static constexpr double kOverheadStep = 0.02;
+    static constexpr int kMaxAttempts = 20;
+
+    std::vector<Fingerprint> solution;
+    uint64_t seed = 0;
+    size_t numSlots = 0;
+
+    size_t startSlot(uint64_t hash) const {
+        size_t numStarts = numSlots - kBandWidth + 1;
+        return static_cast<size_t>((static_cast<unsigned __int128>(hash) * numStarts) >> 64);
+    }
+
+    // The first coefficient is always set, so each row pivots at its start
+    static uint64_t coefficients(uint64_t hash) {
+        return leafFilterMix(hash ^ 0xa0761d6478bd642fULL) | 1;
+    }
+
+    static Fingerprint fingerprintOf(uint64_t hash) {
+        return static_cast<Fingerprint>(hash);
+    }
+
+    bool build(const std::vector<uint64_t>& keyHashes) {
+        // Banding: row i, when occupied, has its leading coefficient at i
+        std::vector<uint64_t> rows(numSlots, 0);
+        std::vector<Fingerprint> results(numSlots, 0);
+        for (uint64_t keyHash : keyHashes) {
+            uint64_t hash = leafFilterMix(keyHash + seed);
+            size_t slot = startSlot(hash);
+            uint64_t coeffs = coefficients(hash);
+            Fingerprint result = fingerprintOf(hash);
+            while (true) {
+                if (rows[slot] == 0) {
+                    rows[slot] = coeffs;
+                    results[slot] = result;
+                    break;
+                }
+                coeffs ^= rows[slot];
+                result ^= results[slot];
+                if (coeffs == 0) {
+                    // Linearly dependent: consistent only if the results agree
+                    if (result != 0) return false;
+                    break;
+                }
+                int shift = std::countr_zero(coeffs);
+                slot += shift;
+                coeffs >>= shift;
+            }
+        }
+
+        // Back substitution; free slots stay zero
+        solution.assign(numSlots, 0);
+        for (size_t i = numSlots; i-- > 0;) {
+            uint64_t coeffs = rows[i];
+            if (coeffs == 0) continue;
+            Fingerprint value = results[i];
+            coeffs &= coeffs - 1;
+            while (coeffs) {
+                value ^= solution[i + std::countr_zero(coeffs)];
+                coeffs &= coeffs - 1;
+            }
+            solution[i] = value;
+        }
+        return true;
+    }
+};
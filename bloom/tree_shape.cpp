@@ -0,0 +1,93 @@
+#include "tree_shape.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+double TreeShapeModel::nodeFpp(double leavesBelow) const {
+    if (bloomSize == 0) return 1.0;
+    double items = itemsPerLeaf * leavesBelow;
+    double fill = 1.0 - std::exp(-numHashFunctions * items / static_cast<double>(bloomSize));
+    return std::pow(fill, numHashFunctions);
+}
+
+namespace {
+
+// A level of `nodes` nodes splits the leaves evenly. A node is checked when
+// its parent passes: always under a pass-through parent, otherwise when the
+// value is below the parent (positiveRate / parents) or on a false positive.
+struct LevelCost {
+    const TreeShapeModel& model;
+
+    bool passThrough(size_t nodes) const {
+        return nodes < model.leaves && model.nodeFpp(static_cast<double>(model.leaves) / nodes) >= kPassThroughFpp;
+    }
+
+    double parentPasses(size_t parents) const {
+        if (passThrough(parents)) return 1.0;
+        double present = std::min(1.0, model.positiveRate / parents);
+        return present + (1.0 - present) * model.nodeFpp(static_cast<double>(model.leaves) / parents);
+    }
+
+    // Checks spent on a level of `nodes` nodes under `parents` parents
+    double checks(size_t nodes, size_t parents) const {
+        if (passThrough(nodes)) return 0.0;
+        return static_cast<double>(nodes) * parentPasses(parents);
+    }
+};
+
+size_t parentCount(size_t nodes, int ratio) {
+    return (nodes + static_cast<size_t>(ratio) - 1) / static_cast<size_t>(ratio);
+}
+
+}  // namespace
+
+double predictBloomChecks(const TreeShapeModel& model, const std::vector<int>& ratios, int fallbackRatio) {
+    if (model.leaves == 0) return 0.0;
+    LevelCost cost{model};
+    double total = 0.0;
+    size_t nodes = model.leaves;
+    for (size_t level = 0; nodes > 1; ++level) {
+        int ratio = std::max(2, level < ratios.size() ? ratios[level] : fallbackRatio);
+        size_t parents = parentCount(nodes, ratio);
+        total += cost.checks(nodes, parents);
+        nodes = parents;
+    }
+    // The root is probed on every query
+    return total + (cost.passThrough(1) ? 0.0 : 1.0);
+}
+
+TreeShape chooseTreeShape(const TreeShapeModel& model, int maxRatio) {
+    TreeShape shape;
+    if (model.leaves == 0) return shape;
+    LevelCost cost{model};
+
+    // best[n]: cheapest (checks, ratio) for the levels from one of n nodes
+    // up to the root; the node count after grouping is all that matters
+    std::unordered_map<size_t, std::pair<double, int>> best;
+    auto solve = [&](auto& self, size_t nodes) -> double {
+        if (nodes == 1) return cost.passThrough(1) ? 0.0 : 1.0;
+        if (auto it = best.find(nodes); it != best.end()) return it->second.first;
+        std::pair<double, int> choice{std::numeric_limits<double>::infinity(), 2};
+        int limit = static_cast<int>(std::min<size_t>(nodes, static_cast<size_t>(std::max(2, maxRatio))));
+        size_t lastParents = 0;
+        for (int ratio = 2; ratio <= limit; ++ratio) {
+            size_t parents = parentCount(nodes, ratio);
+            // Ratios that give the same parent count give the same tree
+            if (parents == lastParents) continue;
+            lastParents = parents;
+            double total = cost.checks(nodes, parents) + self(self, parents);
+            if (total < choice.first) choice = {total, ratio};
+        }
+        best[nodes] = choice;
+        return choice.first;
+    };
+    shape.expectedChecks = solve(solve, model.leaves);
+    for (size_t nodes = model.leaves; nodes > 1;) {
+        int ratio = best.at(nodes).second;
+        shape.ratios.push_back(ratio);
+        nodes = parentCount(nodes, ratio);
+    }
+    return shape;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Internal nodes whose theoretical FPP (fill^k) reaches this are built as
+// pass-through: queries descend without probing them
+inline constexpr double kPassThroughFpp = 0.9;
+
+// What the shape of a tree is chosen from. All internal filters have
+// bloomSize bits and numHashFunctions hashes; a node holds the distinct
+// items of every leaf below it.
+struct TreeShapeModel {
+    size_t leaves = 0;
+    double itemsPerLeaf = 0.0;
+    size_t bloomSize = 0;
+    int numHashFunctions = 0;
+    // Share of point queries whose value is in the tree
+    double positiveRate = 0.5;
+
+    // Theoretical FPP of an internal node over `leavesBelow` leaves
+    double nodeFpp(double leavesBelow) const;
+};
+
+struct TreeShape {
+    // Fanout per level, bottom-up: ratios[0] groups the leaves
+    std::vector<int> ratios;
+    double expectedChecks = 0.0;
+};
+
+// Expected bloom checks of one unbounded point query. Levels past the end
+// of ratios use fallbackRatio.
+double predictBloomChecks(const TreeShapeModel& model, const std::vector<int>& ratios, int fallbackRatio);
+
+// Per-level fanouts in [2, maxRatio] minimising predictBloomChecks
+TreeShape chooseTreeShape(const TreeShapeModel& model, int maxRatio = 64);
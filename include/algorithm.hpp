@@ -3,14 +3,19 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
-#include <functional>
 #include <future>
 #include <iostream>
+#include <numeric>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "bloomTree.hpp"
@@ -26,147 +31,337 @@ inline std::atomic<size_t> gBloomCheckCount{0};
 inline std::atomic<size_t> gLeafBloomCheckCount{0};
 /// Global counter of SSTables checked
 inline std::atomic<size_t> gSSTCheckCount{0};
+/// Global counters of paged-out leaf filter lookups served from / missing
+/// the leaf cache
+inline std::atomic<size_t> gLeafCacheHitCount{0};
+inline std::atomic<size_t> gLeafCacheMissCount{0};
+/// Heap allocations made by the calling thread, counted by the replacement
+/// operator new in main.cpp when built with COUNT_HEAP_ALLOCATIONS (stays 0
+/// otherwise)
+inline thread_local size_t tHeapAllocCount = 0;
+/// Heap allocations of the last multi-column DFS, leaf scans excluded
+inline std::atomic<size_t> gDfsHeapAllocCount{0};
+
+/// Share of paged-out leaf lookups the leaf cache served since the last
+/// reset; 1 when no paged-out leaf was probed
+inline double leafCacheHitRate() {
+  size_t hits = gLeafCacheHitCount.load();
+  size_t lookups = hits + gLeafCacheMissCount.load();
+  return lookups == 0 ? 1.0 : static_cast<double>(hits) / lookups;
+}
+/// Reorder columns by estimated selectivity before the multi-column DFS
+inline bool gColumnOrderingEnabled{true};
 
-// Combination of nodes
+// Combination of nodes, one per column, viewed in a DfsArena. The range
+// views keys of tree nodes or the query bounds, which outlive the DFS.
 struct Combo {
-  std::vector<Node*> nodes;  // One node per column.
-  std::string rangeStart;
-  std::string rangeEnd;
+  std::span<Node* const> nodes;
+  KeyRef rangeStart;
+  KeyRef rangeEnd;
 };
 
 inline std::vector<std::string> globalfinalMatches;
 
 inline void computeIntersection(const std::vector<Node*>& nodes,
-                                std::string& outStart, std::string& outEnd) {
+                                KeyRef& outStart, KeyRef& outEnd) {
   if (nodes.empty()) return;
-  outStart = nodes[0]->startKey;
-  outEnd = nodes[0]->endKey;
+  outStart = nodes[0]->startRef();
+  outEnd = nodes[0]->endRef();
   for (size_t i = 1; i < nodes.size(); ++i) {
-    outStart = std::max(outStart, nodes[i]->startKey);
-    outEnd = std::min(outEnd, nodes[i]->endKey);
+    outStart = std::max(outStart, nodes[i]->startRef());
+    outEnd = std::min(outEnd, nodes[i]->endRef());
   }
 }
 
-inline std::vector<std::string> finalSstScanAndIntersect(
-    const Combo& combo, const std::vector<std::string>& values,
-    DBManager& dbManager) {
-  size_t n = combo.nodes.size();
+/// Multi-column kernels are compiled for 1 to kMaxFixedColumns columns;
+/// N = 0 selects the generic kernel sized at runtime
+inline constexpr size_t kMaxFixedColumns = 16;
+
+// One T per column: a std::array in the kernels for a fixed column count, a
+// std::vector of n elements in the generic one
+template <size_t N, typename T>
+using ColumnArray =
+    std::conditional_t<N == 0, std::vector<T>, std::array<T, N>>;
+
+template <size_t N, typename T>
+ColumnArray<N, T> makeColumnArray(size_t n) {
+  if constexpr (N == 0) {
+    return std::vector<T>(n);
+  } else {
+    return {};
+  }
+}
+
+// Scans each leaf of the combo once for the values every query in the batch
+// expects in that column, then intersects the key sets per query.
+// result[q] belongs to queries[q].
+template <size_t N = 0>
+std::vector<std::vector<std::string>> finalSstScanAndIntersectBatch(
+    const Combo& combo, const std::vector<std::vector<std::string>>& queries,
+    DBManager& dbManager,
+    const DBManager::QuerySnapshot* snapshot = nullptr) {
+  using ValueKeys = std::unordered_map<std::string, std::vector<std::string>>;
+  const size_t n = N == 0 ? combo.nodes.size() : N;
 
   // Increment SSTable check count
   gSSTCheckCount += n;
 
-  std::vector<std::promise<std::unordered_set<std::string>>> promises(n);
-  std::vector<std::future<std::unordered_set<std::string>>> futures;
-  futures.reserve(n);
+  auto promises = makeColumnArray<N, std::promise<ValueKeys>>(n);
+  auto futures = makeColumnArray<N, std::future<ValueKeys>>(n);
 
   for (size_t i = 0; i < n; ++i) {
-    futures.push_back(promises[i].get_future());
+    futures[i] = promises[i].get_future();
     Node* leaf = combo.nodes[i];
-    std::string scanStart = std::max(combo.rangeStart, leaf->startKey);
-    std::string scanEnd = std::min(combo.rangeEnd, leaf->endKey);
+    std::string scanStart(std::max(combo.rangeStart, leaf->startRef()).key);
+    std::string scanEnd(std::min(combo.rangeEnd, leaf->endRef()).key);
+    std::unordered_set<std::string> targets;
+    for (const auto& values : queries) targets.insert(values[i]);
 
     boost::asio::post(
-        globalThreadPool, [leaf, values, i, scanStart, scanEnd, &dbManager,
-                           promise = std::move(promises[i])]() mutable {
+        globalThreadPool,
+        [leaf, targets = std::move(targets), scanStart, scanEnd, &dbManager,
+         snapshot, promise = std::move(promises[i])]() mutable {
           try {
-            // Scan the SST file for keys matching the value.
-            std::vector<std::string> keys = dbManager.scanFileForKeysWithValue(
-                leaf->filename, values[i], scanStart, scanEnd);
-            promise.set_value(
-                std::unordered_set<std::string>(keys.begin(), keys.end()));
+            // One pass over the partition for all target values.
+            promise.set_value(dbManager.scanPartitionForKeysWithValues(
+                *leaf, targets, scanStart, scanEnd, snapshot));
           } catch (const std::exception& e) {
             promise.set_exception(std::current_exception());
           }
         });
   }
 
-  // Collect the key sets from all futures.
-  std::vector<std::unordered_set<std::string>> columnKeySets;
-  columnKeySets.reserve(n);
-  for (auto& fut : futures) {
-    columnKeySets.push_back(fut.get());
+  // Collect the value -> keys maps from all futures.
+  auto columnMatches = makeColumnArray<N, ValueKeys>(n);
+  for (size_t i = 0; i < n; ++i) {
+    columnMatches[i] = futures[i].get();
   }
 
-  // Intersect all key sets
-  if (columnKeySets.empty()) return {};
-
-  std::unordered_set<std::string> result = columnKeySets[0];
-  for (size_t i = 1; i < columnKeySets.size(); ++i) {
-    std::unordered_set<std::string> temp;
-    for (const auto& key : result) {
-      if (columnKeySets[i].find(key) != columnKeySets[i].end()) {
-        temp.insert(key);
+  // Intersect the key sets of every query
+  std::vector<std::vector<std::string>> results(queries.size());
+  for (size_t q = 0; q < queries.size(); ++q) {
+    auto first = columnMatches[0].find(queries[q][0]);
+    if (first == columnMatches[0].end()) continue;
+
+    std::unordered_set<std::string> result(first->second.begin(),
+                                           first->second.end());
+    for (size_t i = 1; i < n && !result.empty(); ++i) {
+      auto it = columnMatches[i].find(queries[q][i]);
+      if (it == columnMatches[i].end()) {
+        result.clear();
+        break;
+      }
+      std::unordered_set<std::string> column(it->second.begin(),
+                                             it->second.end());
+      std::unordered_set<std::string> temp;
+      for (const auto& key : result) {
+        if (column.find(key) != column.end()) {
+          temp.insert(key);
+        }
       }
+      result = std::move(temp);
     }
-    result = std::move(temp);
-    if (result.empty()) break;
+    results[q].assign(result.begin(), result.end());
   }
+  return results;
+}
 
-  return std::vector<std::string>(result.begin(), result.end());
+template <size_t N = 0>
+std::vector<std::string> finalSstScanAndIntersect(
+    const Combo& combo, const std::vector<std::string>& values,
+    DBManager& dbManager,
+    const DBManager::QuerySnapshot* snapshot = nullptr) {
+  if (combo.nodes.empty()) return {};
+  return std::move(
+      finalSstScanAndIntersectBatch<N>(combo, {values}, dbManager, snapshot)
+          .front());
 }
 
-// DFS with per‑level range pruning and optional first‑column parallel split
-inline void dfsMultiColumn(const std::vector<std::string>& values,
-                           Combo currentCombo, DBManager& dbManager,
-                           bool isInitialCall) {
-                            //check roots
-if (isInitialCall) {
-  for (size_t i = 0; i < currentCombo.nodes.size(); ++i) {
-    ++gBloomCheckCount;
-    if (!currentCombo.nodes[i]->bloom.exists(values[i]))
+// Scratch of a multi-column DFS. The combo and the candidate lists of every
+// open level are stacked in flat vectors addressed by index, so once they
+// have grown to the deepest level the enumeration allocates nothing.
+struct DfsArena {
+  size_t columns = 0;
+  std::vector<Node*> combos;         // combo of depth d at [d * columns, ...)
+  std::vector<Node*> candidates;     // candidate lists of all open levels
+  std::vector<size_t> columnBegins;  // columns + 1 offsets into candidates
+                                     // per open level
+  std::vector<uint32_t> hashes;      // each column's value, hashed once
+  std::vector<size_t> hashBegins;
+  size_t scanAllocs = 0;             // allocations of the leaf scans
+  const DBManager::QuerySnapshot* snapshot = nullptr;  // of the running query
+
+  // roots[i] is the root of column i, which is probed for values[i]
+  void reset(const std::vector<Node*>& roots,
+             const std::vector<std::string>& values) {
+    columns = roots.size();
+    combos.assign(roots.begin(), roots.end());
+    candidates.clear();
+    columnBegins.clear();
+    hashes.clear();
+    hashBegins.clear();
+    for (size_t i = 0; i < columns; ++i) {
+      const BloomFilter& bloom = roots[i]->bloom;
+      hashBegins.push_back(hashes.size());
+      hashes.resize(hashes.size() + bloom.numHashFunctions);
+      bloom.computeHashes(values[i], &hashes[hashBegins.back()]);
+    }
+    scanAllocs = 0;
+  }
+  const uint32_t* columnHashes(size_t column) const {
+    return &hashes[hashBegins[column]];
+  }
+};
+
+template <size_t N>
+void dfsMultiColumn(const std::vector<std::string>& values, DfsArena& arena,
+                    size_t depth, const KeyRef& rangeStart,
+                    const KeyRef& rangeEnd, DBManager& dbManager);
+
+// Chooses the candidate of column Idx (idx in the generic kernel) and
+// recursively of the later columns for the combo of depth + 1, narrowing
+// (curS, curE) on the way. With N fixed every column is its own
+// instantiation, so the chain of range tightenings is unrolled.
+template <size_t N, size_t Idx>
+void enumerateCombos(const std::vector<std::string>& values, DfsArena& arena,
+                     size_t depth, size_t begins, size_t idx,
+                     const KeyRef& curS, const KeyRef& curE,
+                     DBManager& dbManager) {
+  if constexpr (N > 0 && Idx == N) {
+    dfsMultiColumn<N>(values, arena, depth + 1, curS, curE, dbManager);
+  } else {
+    const size_t n = N == 0 ? arena.columns : N;
+    const size_t col = N == 0 ? idx : Idx;
+    if (N == 0 && col == n) {
+      dfsMultiColumn<N>(values, arena, depth + 1, curS, curE, dbManager);
       return;
+    }
+    size_t end = arena.columnBegins[begins + col + 1];
+    for (size_t c = arena.columnBegins[begins + col]; c < end; ++c) {
+      Node* cand = arena.candidates[c];
+      KeyRef ns = std::max(curS, cand->startRef());
+      KeyRef ne = std::min(curE, cand->endRef());
+      if (ns <= ne) {
+        arena.combos[(depth + 1) * n + col] = cand;
+        if constexpr (N > 0) {
+          enumerateCombos<N, Idx + 1>(values, arena, depth, begins, idx, ns,
+                                      ne, dbManager);
+        } else {
+          enumerateCombos<N, 0>(values, arena, depth, begins, idx + 1, ns, ne,
+                                dbManager);
+        }
+      }
+    }
   }
 }
 
+// DFS with per‑level range pruning over the combo of arena at depth; depth 0
+// holds the roots. N is the column count (0: taken from the arena); filters
+// are probed with the hashes the arena computed once per column.
+template <size_t N>
+void dfsMultiColumn(const std::vector<std::string>& values, DfsArena& arena,
+                    size_t depth, const KeyRef& rangeStart,
+                    const KeyRef& rangeEnd, DBManager& dbManager) {
+  const size_t n = N == 0 ? arena.columns : N;
+  // Valid until step 5 grows the combos
+  Node* const* combo = &arena.combos[depth * n];
+  // 1) check roots
+  if (depth == 0) {
+    for (size_t i = 0; i < n; ++i) {
+      if (combo[i]->passThrough) continue;
+      ++gBloomCheckCount;
+      if (!combo[i]->mayContainHashes(values[i], arena.columnHashes(i))) {
+        return;
+      }
+    }
+  }
+
   // 2) range check
-  if (currentCombo.rangeStart > currentCombo.rangeEnd) return;
+  if (rangeStart > rangeEnd) return;
 
   // 3) leaf‑check
   bool allLeaves = true;
-  for (auto* nd : currentCombo.nodes) {
-    if (nd->filename == "Memory") {
+  for (size_t i = 0; i < n; ++i) {
+    if (!combo[i]->isLeaf()) {
       allLeaves = false;
       break;
     }
   }
   if (allLeaves) {
-    auto keys = finalSstScanAndIntersect(currentCombo, values, dbManager);
+    size_t allocs = tHeapAllocCount;
+    auto keys = finalSstScanAndIntersect<N>(
+        Combo{{combo, n}, rangeStart, rangeEnd}, values, dbManager,
+        arena.snapshot);
     globalfinalMatches.insert(globalfinalMatches.end(), keys.begin(),
                               keys.end());
+    arena.scanAllocs += tHeapAllocCount - allocs;
     return;
   }
 
-  // 4) build candidateOptions with progressive range tightening
-  size_t n = currentCombo.nodes.size();
-  std::vector<std::vector<Node*>> candidateOptions(n);
-  std::string tightStart = currentCombo.rangeStart;
-  std::string tightEnd = currentCombo.rangeEnd;
+  // 4) stack the candidates of every column with progressive range
+  // tightening; they are popped again on every way out of this level
+  struct Unwind {
+    DfsArena& arena;
+    size_t candidates;
+    size_t begins;
+    ~Unwind() {
+      arena.candidates.resize(candidates);
+      arena.columnBegins.resize(begins);
+    }
+  } unwind{arena, arena.candidates.size(), arena.columnBegins.size()};
+  const size_t begins = unwind.begins;
+  KeyRef tightStart = rangeStart;
+  KeyRef tightEnd = rangeEnd;
 
   for (size_t i = 0; i < n; ++i) {
-    Node* node = currentCombo.nodes[i];
-    std::string colMin, colMax;
+    Node* node = combo[i];
+    const uint32_t* hashes = arena.columnHashes(i);
+    arena.columnBegins.push_back(arena.candidates.size());
+    KeyRef colMin, colMax;
     bool found = false;
 
-    auto consider = [&](Node* c) {
-      if (c->endKey < tightStart || c->startKey > tightEnd) return;
+    // probed: the child slices' answer for c, or -1 to probe c itself
+    auto consider = [&](Node* c, int probed) {
       ++gBloomCheckCount;
-      if (c->filename != "Memory") ++gLeafBloomCheckCount;
-      if (!c->bloom.exists(values[i])) return;
-      candidateOptions[i].push_back(c);
+      if (c->isLeaf()) ++gLeafBloomCheckCount;
+      if (probed < 0 ? !c->mayContainHashes(values[i], hashes) : probed == 0) {
+        return;
+      }
+      arena.candidates.push_back(c);
       if (!found) {
-        colMin = c->startKey;
-        colMax = c->endKey;
+        colMin = c->startRef();
+        colMax = c->endRef();
         found = true;
       } else {
-        colMin = std::min(colMin, c->startKey);
-        colMax = std::max(colMax, c->endKey);
+        colMin = std::min(colMin, c->startRef());
+        colMax = std::max(colMax, c->endRef());
       }
     };
 
-    if (node->filename == "Memory") {
-      for (auto* ch : node->children) consider(ch);
-    } else {
-      consider(node);
+    // Pass-through children are replaced by their own children; with child
+    // slices one probe of the parent answers for all of its children. Only
+    // the children the fences bracket around the tight range are looked at.
+    auto expand = [&](auto& self, Node* parent) -> void {
+      auto [first, last] =
+          parent->childFences.overlapRange(tightStart.fence, tightEnd.fence);
+      if (first == last) return;
+      const ChildSlices* slices = parent->childSlices.get();
+      uint64_t mask = slices ? slices->mayContain(hashes) : 0;
+      for (size_t c = first; c < last; ++c) {
+        Node* ch = parent->children[c];
+        if (ch->endRef() < tightStart || ch->startRef() > tightEnd) continue;
+        if (ch->passThrough) {
+          self(self, ch);
+        } else {
+          consider(ch, slices ? static_cast<int>((mask >> c) & 1) : -1);
+        }
+      }
+    };
+
+    if (!node->isLeaf()) {
+      expand(expand, node);
+    } else if (node->endRef() >= tightStart && node->startRef() <= tightEnd) {
+      consider(node, -1);
     }
     if (!found) return;
 
@@ -176,38 +371,79 @@ if (isInitialCall) {
       if (tightStart > tightEnd) return;
     }
   }
+  arena.columnBegins.push_back(arena.candidates.size());
 
-  // 5) prepare backtrack that carries (curStart,curEnd)
-  std::function<void(size_t, std::vector<Node*>&, const std::string&,
-                     const std::string&)>
-      backtrack;
+  // 5) enumerate the combos of the next level
+  if (arena.combos.size() < (depth + 2) * n) {
+    arena.combos.resize((depth + 2) * n);
+  }
+  enumerateCombos<N, 0>(values, arena, depth, begins, 0, rangeStart, rangeEnd,
+                        dbManager);
+}
 
-  backtrack = [&](size_t idx, std::vector<Node*>& chosen,
-                  const std::string& curS, const std::string& curE) {
-    if (idx == n) {
-      Combo next{chosen, curS, curE};
-      dfsMultiColumn(values, next, dbManager, false);
-      return;
-    }
-    for (auto* cand : candidateOptions[idx]) {
-      auto ns = std::max(curS, cand->startKey);
-      auto ne = std::min(curE, cand->endKey);
-      if (ns <= ne) {
-        chosen[idx] = cand;
-        backtrack(idx + 1, chosen, ns, ne);
-      }
+using DfsKernel = void (*)(const std::vector<std::string>&, DfsArena&, size_t,
+                           const KeyRef&, const KeyRef&, DBManager&);
+
+template <size_t... Ns>
+constexpr std::array<DfsKernel, sizeof...(Ns)> makeDfsKernels(
+    std::index_sequence<Ns...>) {
+  return {&dfsMultiColumn<Ns>...};
+}
+
+/// dfsMultiColumn by column count; entry 0 is the generic kernel
+inline constexpr std::array<DfsKernel, kMaxFixedColumns + 1> kDfsKernels =
+    makeDfsKernels(std::make_index_sequence<kMaxFixedColumns + 1>{});
+
+// Estimated share of a column's rows that can still match `value` after the
+// first level: children whose filter rejects the value drop their estimated
+// cardinality. 0 means the root already rules the column out.
+inline double estimateColumnSelectivity(const Node* root,
+                                        const std::string& value) {
+  if (!root->passThrough) {
+    ++gBloomCheckCount;
+    if (!root->mayContain(value)) return 0.0;
+  }
+  if (root->children.empty()) return 1.0;
+
+  double total = 0.0;
+  double passing = 0.0;
+  for (const Node* child : root->children) {
+    double card = child->estimatedCardinality();
+    total += card;
+    if (child->passThrough) {
+      passing += card;
+      continue;
     }
-  };
+    ++gBloomCheckCount;
+    if (child->isLeaf()) ++gLeafBloomCheckCount;
+    if (child->mayContain(value)) passing += card;
+  }
+  return total > 0.0 ? passing / total : 1.0;
+}
+
+// Column permutation for dfsMultiColumn, most selective column first.
+inline std::vector<size_t> planColumnOrder(
+    const std::vector<BloomTree>& trees,
+    const std::vector<std::string>& values) {
+  std::vector<size_t> order(trees.size());
+  std::iota(order.begin(), order.end(), 0);
 
-  std::vector<Node*> chosen(n, nullptr);
-  backtrack(0, chosen, currentCombo.rangeStart, currentCombo.rangeEnd);
+  std::vector<double> selectivity(trees.size());
+  for (size_t i = 0; i < trees.size(); ++i) {
+    selectivity[i] = estimateColumnSelectivity(trees[i].root, values[i]);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return selectivity[a] < selectivity[b];
+  });
+  return order;
 }
 
 // Multi-column hierarchical query interface.
 inline std::vector<std::string> multiColumnQueryHierarchical(
     std::vector<BloomTree>& trees, const std::vector<std::string>& values,
     const std::string& globalStart, const std::string& globalEnd,
-    DBManager& dbManager) {
+    DBManager& dbManager,
+    const DBManager::QuerySnapshot* snapshot = nullptr) {
   StopWatch sw;
   sw.start();
   size_t n = trees.size();
@@ -222,20 +458,52 @@ inline std::vector<std::string> multiColumnQueryHierarchical(
   gBloomCheckCount = 0;
   gLeafBloomCheckCount = 0;
   gSSTCheckCount = 0;
+  gLeafCacheHitCount = 0;
+  gLeafCacheMissCount = 0;
+
+  // The DFS result is the key intersection, so it does not depend on the
+  // column order and needs no mapping back after the permutation.
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  if (gColumnOrderingEnabled && n > 1) {
+    order = planColumnOrder(trees, values);
+  }
 
-  Combo start;
-  start.nodes.resize(n);
-  std::string s = globalStart.empty() ? trees[0].root->startKey : globalStart;
-  std::string e = globalEnd.empty() ? trees[0].root->endKey : globalEnd;
+  std::vector<Node*> roots(n);
+  std::vector<std::string> orderedValues(n);
+  KeyRef s = globalStart.empty() ? trees[0].root->startRef()
+                                 : KeyRef(globalStart);
+  KeyRef e =
+      globalEnd.empty() ? trees[0].root->endRef() : KeyRef(globalEnd);
   for (size_t i = 0; i < n; ++i) {
-    start.nodes[i] = trees[i].root;
-    s = std::max(s, trees[i].root->startKey);
-    e = std::min(e, trees[i].root->endKey);
+    const BloomTree& tree = trees[order[i]];
+    roots[i] = tree.root;
+    orderedValues[i] = values[order[i]];
+    s = std::max(s, tree.root->startRef());
+    e = std::min(e, tree.root->endRef());
   }
-  start.rangeStart = s;
-  start.rangeEnd = e;
   globalfinalMatches.clear();
-  dfsMultiColumn(values, start, dbManager, true);
+  // Reused by every query of the thread, so a warm DFS does not allocate
+  thread_local DfsArena arena;
+  arena.reset(roots, orderedValues);
+  arena.snapshot = snapshot;
+  DfsKernel kernel = kDfsKernels[n <= kMaxFixedColumns ? n : 0];
+  size_t allocs = tHeapAllocCount;
+  kernel(orderedValues, arena, 0, s, e, dbManager);
+  gDfsHeapAllocCount = tHeapAllocCount - allocs - arena.scanAllocs;
+
+  // Drops keys matched through overwritten SST versions and adds writes the
+  // trees cannot see yet, when every tree knows its column
+  std::vector<std::string> columns;
+  for (const auto& tree : trees) columns.push_back(tree.column);
+  if (std::none_of(columns.begin(), columns.end(),
+                   [](const std::string& c) { return c.empty(); })) {
+    globalfinalMatches = dbManager.applyMemtableDelta(
+        columns, values,
+        dbManager.verifyKeysInColumns(globalfinalMatches, columns, values,
+                                      snapshot),
+        snapshot);
+  }
 
   sw.stop();
   spdlog::critical(
@@ -246,5 +514,12 @@ inline std::vector<std::string> multiColumnQueryHierarchical(
       "{}",
       gBloomCheckCount.load(), gLeafBloomCheckCount.load(),
       gSSTCheckCount.load());
+#ifdef COUNT_HEAP_ALLOCATIONS
+  spdlog::info("DFS heap allocations: {}", gDfsHeapAllocCount.load());
+#endif
+  if (gLeafCacheMissCount.load() > 0) {
+    spdlog::info("Leaf cache hit rate: {:.3f} ({} misses)", leafCacheHitRate(),
+                 gLeafCacheMissCount.load());
+  }
   return globalfinalMatches;
 }
@@ -11,17 +11,29 @@ extern boost::asio::thread_pool globalThreadPool;
 
 class BloomManager {
    public:
+    // A branchingRatio of 0 picks the fanout of every level from the shape
+    // cost model, for queries that hit the tree at expectedPositiveRate
     BloomTree createPartitionedHierarchy(const std::vector<std::string>& sstFiles,
                                          size_t partitionSize,
                                          size_t bloomSize,
                                          int numHashFunctions,
-                                         int branchingRatio);
+                                         int branchingRatio,
+                                         bool buildValueIndex = false,
+                                         LeafFilterType leafFilterType = LeafFilterType::Bloom,
+                                         bool countingLeaves = false,
+                                         size_t leafCacheBytes = 0,
+                                         double expectedPositiveRate = 0.5,
+                                         int internalFoldShift = 0,
+                                         bool childSlices = false);
 
    private:
-    std::vector<Node*> processSSTFile(const std::string& sstFile,
-                                      size_t partitionSize,
-                                      size_t bloomSize,
-                                      int numHashFunctions);
+    std::vector<Node> processSSTFile(const std::string& sstFile,
+                                     size_t partitionSize,
+                                     size_t bloomSize,
+                                     int numHashFunctions,
+                                     bool buildValueIndex,
+                                     LeafFilterType leafFilterType,
+                                     bool countingLeaves);
 };
 
 #endif  // BLOOM_MANAGER_HPP
@@ -5,41 +5,84 @@
 #include <rocksdb/sst_file_manager.h>
 #include <rocksdb/sst_file_reader.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "bloomTree.hpp"
+#include "memtable_delta.hpp"
+
+struct TreeVersion;
 
 class DBManager {
  public:
   void compactAllColumnFamilies(size_t numRecords = 0);
   void openDB(const std::string &dbname,
               std::vector<std::string> columns = {"phone", "mail", "address"});
+  // Bulk loads write through WriteBatches that bypass the memtable deltas;
+  // they flush before returning, so trees built afterwards cover them
   void insertRecords(int numRecords, std::vector<std::string> columns);
   void insertRecordsWithSearchTargets(
       int numRecords, const std::vector<std::string> &columns,
       const std::unordered_set<int> &targetIndices);
   std::vector<std::string> scanSSTFilesForColumn(const std::string &dbname,
                                                  const std::string &column);
+  // Live SST file of column a point read of key reaches first, by key
+  // range, named as in scanSSTFilesForColumn; empty if none covers key
+  std::string sstFileForKey(const std::string &dbname,
+                            const std::string &column, const std::string &key);
   bool isOpen() const { return static_cast<bool>(db_); }
   rocksdb::Status closeDB();
 
+  // One query's view: a RocksDB snapshot and the tree version it was pinned
+  // with, kept alive together with the SST files of those trees until
+  // destroyed. Query functions given the handle read that sequence only.
+  // Any number can be held at once; writers are not blocked.
+  class QuerySnapshot {
+   public:
+    QuerySnapshot(QuerySnapshot &&other) noexcept;
+    QuerySnapshot(const QuerySnapshot &) = delete;
+    QuerySnapshot &operator=(const QuerySnapshot &) = delete;
+    QuerySnapshot &operator=(QuerySnapshot &&) = delete;
+    ~QuerySnapshot();
+
+    uint64_t sequenceNumber() const;
+    const rocksdb::Snapshot *snapshot() const { return snapshot_; }
+    const TreeVersion &version() const { return *version_; }
+
+   private:
+    friend class DBManager;
+    QuerySnapshot(DBManager *owner, const rocksdb::Snapshot *snapshot,
+                  std::shared_ptr<const TreeVersion> version)
+        : owner_(owner), snapshot_(snapshot), version_(std::move(version)) {}
+    DBManager *owner_;
+    const rocksdb::Snapshot *snapshot_;
+    std::shared_ptr<const TreeVersion> version_;
+  };
+
+  // Throws if a leaf refers to an SST file that is no longer live, i.e. the
+  // trees are older than the files on disk.
+  QuerySnapshot pinQuerySnapshot(std::shared_ptr<const TreeVersion> version);
+
   std::string getValue(const std::string &column_family_name,
                        const std::string &key);
   rocksdb::ColumnFamilyHandle *getColumnFamilyHandle(
       const std::string &column_family_name);
 
+  // compact = false leaves the SST files (and trees built on them) intact
   rocksdb::Status applyModifications(
       const std::vector<std::tuple<std::string, std::string, std::string>>
           &modifications,
-      size_t numRecords);
+      size_t numRecords, bool compact = true);
   rocksdb::Status revertModifications(
       const std::vector<std::tuple<std::string, std::string, std::string>>
           &reversions,
-      size_t numRecords);
+      size_t numRecords, bool compact = true);
 
   // key - value
   bool checkValueWithoutBloomFilters(const std::string &value);
@@ -53,26 +96,102 @@ class DBManager {
   // multiple columns without Bloom filters
   std::vector<std::string> scanForRecordsInColumns(
       const std::vector<std::string> &columns,
-      const std::vector<std::string> &values);
+      const std::vector<std::string> &values,
+      const QuerySnapshot *snapshot = nullptr);
   // scan given SST file for keys with a specific value
   std::vector<std::string> scanFileForKeysWithValue(
       const std::string &filename, const std::string &value,
       const std::string &rangeStart, const std::string &rangeEnd);
+  // scan given SST file once for keys with any of the values (value -> keys)
+  std::unordered_map<std::string, std::vector<std::string>>
+  scanFileForKeysWithValues(const std::string &filename,
+                            const std::unordered_set<std::string> &values,
+                            const std::string &rangeStart,
+                            const std::string &rangeEnd);
+  // same for one leaf partition; uses its value index, when built, to read
+  // only the row runs that may hold a value instead of the whole partition.
+  // Leaves updated in place are read from their column instead.
+  std::unordered_map<std::string, std::vector<std::string>>
+  scanPartitionForKeysWithValues(const Node &leaf,
+                                 const std::unordered_set<std::string> &values,
+                                 const std::string &rangeStart,
+                                 const std::string &rangeEnd,
+                                 const QuerySnapshot *snapshot = nullptr);
+  // scan the current state of a column over a key range (memtable and SSTs)
+  std::unordered_map<std::string, std::vector<std::string>>
+  scanColumnRangeForKeysWithValues(
+      const std::string &column, const std::unordered_set<std::string> &values,
+      const std::string &rangeStart, const std::string &rangeEnd,
+      const QuerySnapshot *snapshot = nullptr);
+  // writes to column the published trees may not cover, null for an
+  // unknown column
+  const MemtableDelta *memtableDelta(const std::string &column) const;
+  // Writes up to this sequence are in SST files (0 before the first
+  // compactAllColumnFamilies); trees built from the files listed after it
+  // cover them
+  uint64_t flushedSequence() const { return flushedSequence_; }
+  // Forgets the delta writes up to sequence once trees covering them are
+  // published; TreeCatalog::publish calls it, trees kept elsewhere must.
+  // Writes the trees of a pinned query snapshot miss are kept.
+  void releaseMemtableDeltas(uint64_t sequence);
+  // reconciles keys matched through trees with the writes they cannot see:
+  // overwritten keys are rechecked and keys written with the searched values
+  // are added once all columns match. With a snapshot, only the writes it
+  // sees count.
+  std::vector<std::string> applyMemtableDelta(
+      const std::vector<std::string> &columns,
+      const std::vector<std::string> &values,
+      const std::vector<std::string> &treeMatches,
+      const QuerySnapshot *snapshot = nullptr);
   // query hierarchy for one column and then get from DB
   std::vector<std::string> findUsingSingleHierarchy(
       BloomTree &hierarchy, const std::vector<std::string> &columns,
-      const std::vector<std::string> &values);
+      const std::vector<std::string> &values,
+      const QuerySnapshot *snapshot = nullptr);
+  // same for a batch of queries; each candidate partition is scanned once
+  std::vector<std::vector<std::string>> findUsingSingleHierarchyBatch(
+      BloomTree &hierarchy, const std::vector<std::string> &columns,
+      const std::vector<std::vector<std::string>> &valueRows,
+      const QuerySnapshot *snapshot = nullptr);
+
+  // Keeps the keys whose current value in every column is the expected one.
+  // Raw SST scans also see versions a newer level has overwritten, so this
+  // reads all columns through batched MultiGets under a single snapshot,
+  // the given one or one taken for the call.
+  std::vector<std::string> verifyKeysInColumns(
+      const std::vector<std::string> &allKeys,
+      const std::vector<std::string> &columns,
+      const std::vector<std::string> &values,
+      const QuerySnapshot *snapshot = nullptr);
 
  private:
+
   struct RocksDBDeleter {
     void operator()(rocksdb::DB *dbPtr) const {
       delete dbPtr;  // Safe to call delete on a nullptr
     }
   };
 
+  void releaseQuerySnapshot(const rocksdb::Snapshot *snapshot);
+  // fill_cache off, at the query snapshot when there is one
+  static rocksdb::ReadOptions queryReadOptions(const QuerySnapshot *snapshot);
+
+  // Put that also records the write in the column's memtable delta
+  rocksdb::Status putTracked(const std::string &column,
+                             rocksdb::ColumnFamilyHandle *handle,
+                             const std::string &key, const std::string &value);
+
   std::unique_ptr<rocksdb::DB, RocksDBDeleter> db_{nullptr};
   std::unordered_map<std::string, std::unique_ptr<rocksdb::ColumnFamilyHandle>>
       cf_handles_;
+  // one per column family, created with the handles; released on publish
+  std::unordered_map<std::string, std::unique_ptr<MemtableDelta>>
+      memtableDeltas_;
+  std::mutex trackedWriteMutex_;
+  std::atomic<uint64_t> flushedSequence_{0};
+  // Pinned query snapshots -> flushed sequence of their tree version
+  std::map<const rocksdb::Snapshot *, uint64_t> pinnedSnapshots_;
+  mutable std::mutex pinnedMutex_;
 };
 
 #endif  // DB_MANAGER_HPP
@@ -5,10 +5,11 @@
 #include <string>
 #include <vector>
 
+#include "db_manager.hpp"
+#include "query_planner.hpp"
 #include "test_params.hpp"
 
 // Forward declarations
-class DBManager;
 class BloomManager;
 class BloomTree;
 
@@ -129,6 +130,12 @@ struct AccumulatedQueryMetrics {
   double avgFalseMultiSSTChecksPerColumn;
 };
 
+struct PlannedQueryResult {
+  int queryIndex;
+  bool isRealData;
+  QueryExplain explain;
+};
+
 struct AggregatedQueryTimings {
   TimingStatistics globalScanTimeStats;
   TimingStatistics hierarchicalMultiTimeStats;
@@ -178,7 +185,8 @@ AggregatedQueryTimings runStandardQueries(
 AggregatedQueryTimings runStandardQueriesWithTarget(
     DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
     const std::vector<std::string>& columns, size_t dbSize, int numRuns,
-    bool skipDbScan, std::vector<std::string> currentExpectedValues);
+    bool skipDbScan, std::vector<std::string> currentExpectedValues,
+    const DBManager::QuerySnapshot* snapshot = nullptr);
 
 // Helper function to generate dynamic patterns based on column count
 std::vector<std::vector<bool>> generateDynamicPatterns(size_t numColumns);
@@ -197,6 +205,13 @@ std::vector<MixedQueryResult> runMixedQueriesWithCsvData(
     const std::vector<std::string>& columns, size_t dbSize, int numQueries, 
     double realDataPercentage);
 
+// Function to run N mixed queries through the cost-based planner, recording
+// estimated vs. actual checks for each
+std::vector<PlannedQueryResult> runPlannedQueriesWithCsvData(
+    DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
+    const std::vector<std::string>& columns, size_t dbSize, int numQueries,
+    double realDataPercentage);
+
 // Function to run comprehensive analysis across multiple real data percentages
 std::vector<AccumulatedQueryMetrics> runComprehensiveQueryAnalysis(
     DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
@@ -204,6 +219,13 @@ std::vector<AccumulatedQueryMetrics> runComprehensiveQueryAnalysis(
 
 void writeCsvHeader(const std::string& filename, const std::string& headerLine);
 
+// Per-level tree statistics: one row per (column, level), prefixed with
+// dbSize and itemsPerPartition
+void writeTreeStatsHeader(const std::string& filename);
+void appendTreeStats(const std::string& filename, size_t dbSize,
+                     size_t itemsPerPartition,
+                     const std::map<std::string, BloomTree>& hierarchies);
+
 double getProbabilityOfFalsePositive(size_t bloomSize, int numHashFunctions,
                                      size_t itemsPerPartition);
 
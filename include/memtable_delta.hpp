@@ -0,0 +1,64 @@
+#ifndef MEMTABLE_DELTA_HPP
+#define MEMTABLE_DELTA_HPP
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bloom_value.hpp"
+
+// Writes to one column that the published trees may not cover yet: kept
+// past the flush that puts them in SST files until trees built from those
+// files are published. Every write of a key is kept with its sequence
+// number, so a reader at a query snapshot sees the version it would read
+// from RocksDB. The bloom filter gives the cheap negative answer; the maps
+// are exact and authoritative (the bloom keeps overwritten values, which
+// only costs a map lookup).
+class MemtableDelta {
+ public:
+  static constexpr size_t kDefaultBloomSize = 1 << 20;
+  // Reader sequence that sees every write
+  static constexpr uint64_t kLatest = UINT64_MAX;
+
+  explicit MemtableDelta(size_t bloomSize = kDefaultBloomSize,
+                         int numHashFunctions = 3);
+
+  // sequence is the RocksDB sequence number of the write
+  void recordWrite(const std::string &key, const std::string &value,
+                   uint64_t sequence);
+  // Drops the writes made at or before sequence
+  void releaseThrough(uint64_t sequence);
+  void clear();
+
+  bool empty() const;
+  bool mayContain(const std::string &value) const;
+  // Keys whose latest write at or before sequence has value
+  std::vector<std::string> keysWithValue(const std::string &value,
+                                         uint64_t sequence = kLatest) const;
+  // Value of the latest write of key at or before sequence, if any
+  std::optional<std::string> latestValue(const std::string &key,
+                                         uint64_t sequence = kLatest) const;
+
+ private:
+  struct Write {
+    std::string value;
+    uint64_t sequence;
+  };
+
+  // Latest write of key at or before sequence, null if none
+  const Write *visibleWrite(const std::string &key, uint64_t sequence) const;
+
+  mutable std::shared_mutex mutex_;
+  BloomFilter bloom_;
+  // Writes of each key in sequence order
+  std::unordered_map<std::string, std::vector<Write>> writes_;
+  // Keys with any kept write of the value
+  std::unordered_map<std::string, std::unordered_set<std::string>>
+      keysByValue_;
+};
+
+#endif  // MEMTABLE_DELTA_HPP
@@ -0,0 +1,70 @@
+#ifndef QUERY_PLANNER_HPP
+#define QUERY_PLANNER_HPP
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bloomTree.hpp"
+
+class DBManager;
+
+enum class QueryStrategy { MultiColumn, SingleHierarchy, FullScan };
+
+const char* queryStrategyName(QueryStrategy strategy);
+
+// Per-operation costs used to turn estimated work into estimated time.
+// Defaults are rough fits to the 50m_csv exp1/exp5/exp8 measurements.
+struct PlannerCostModel {
+  double bloomCheckMicros = 2.5;
+  double partitionRowScanMicros = 0.25;
+  double pointGetMicros = 5.0;
+  double fullScanRowMicros = 0.36;
+  size_t scanParallelism = std::thread::hardware_concurrency();
+};
+
+struct StrategyEstimate {
+  QueryStrategy strategy;
+  size_t primaryColumn = 0;  // driving column for SingleHierarchy
+  double bloomChecks = 0.0;
+  double sstChecks = 0.0;
+  double costMicros = 0.0;
+};
+
+struct QueryPlan {
+  std::vector<StrategyEstimate> estimates;
+  StrategyEstimate chosen;
+  size_t planningBloomChecks = 0;  // probes spent by the planner itself
+};
+
+struct QueryExplain {
+  QueryPlan plan;
+  size_t actualBloomChecks = 0;
+  size_t actualLeafBloomChecks = 0;
+  size_t actualSSTChecks = 0;
+  // Paged-out leaf lookups served by / missing the leaf cache
+  size_t leafCacheHits = 0;
+  size_t leafCacheMisses = 0;
+  long long actualMicros = 0;
+  size_t matches = 0;
+
+  void log() const;
+};
+
+// Estimates every strategy from each tree's build-time profile (per-level
+// fill ratios, leaf counts, rows per partition) plus a root/children probe
+// per column, and picks the cheapest one.
+QueryPlan planQuery(const std::vector<BloomTree>& trees,
+                    const std::vector<std::string>& values,
+                    const PlannerCostModel& costModel = PlannerCostModel{});
+
+// Runs the chosen strategy. When explain is given, it is filled with the plan
+// and the actual counters/time of the execution.
+std::vector<std::string> executeQueryPlan(
+    const QueryPlan& plan, std::vector<BloomTree>& trees,
+    const std::vector<std::string>& columns,
+    const std::vector<std::string>& values, DBManager& dbManager,
+    QueryExplain* explain = nullptr);
+
+#endif  // QUERY_PLANNER_HPP
@@ -3,12 +3,33 @@
 #include <string>
 #include <cstddef>
 
+#include "leaf_filter.hpp"
+
 struct TestParams {
     std::string dbName;
     int numRecords;
-    int bloomTreeRatio;
+    int bloomTreeRatio;  // 0: per-level ratios from the shape cost model
     int numberOfAttempts;
     size_t itemsPerPartition;
     size_t bloomSize;
     int numHashFunctions;
+    // Build a PartitionIndex next to every leaf bloom filter
+    bool buildValueIndex = false;
+    LeafFilterType leafFilterType = LeafFilterType::Bloom;
+    // Keep 4-bit counters behind the leaf blooms for in-place updates
+    bool countingLeaves = false;
+    // Tiered mode: page the leaf blooms out and cache this many bytes of
+    // them (0 keeps every leaf resident)
+    size_t leafCacheBytes = 0;
+    // Share of queries whose value is in the tree, for the shape cost model
+    // used when bloomTreeRatio is 0
+    double expectedPositiveRate = 0.5;
+    // Internal levels built this many folds below the level under them
+    int internalFoldShift = 0;
+    // Cap on the internal filter bytes of each tree, met by folding after
+    // the build (0: no cap). Either option rounds bloomSize up to a power
+    // of two.
+    size_t internalBytesBudget = 0;
+    // Bit-sliced child filters on every internal node
+    bool childSlices = false;
 };
@@ -0,0 +1,69 @@
+#ifndef TREE_CATALOG_HPP
+#define TREE_CATALOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bloomTree.hpp"
+#include "test_params.hpp"
+
+class BloomManager;
+class DBManager;
+
+// One published set of per-column trees. Never modified once published;
+// a query keeps the version it started on alive until it finishes.
+struct TreeVersion {
+  uint64_t id = 0;
+  std::map<std::string, BloomTree> trees;
+  // Writes up to this sequence are in the SST files the trees were built
+  // from (0 if unknown)
+  uint64_t flushedSequence = 0;
+
+  // The trees of columns, in order, as the query functions take them
+  std::vector<BloomTree> treesFor(const std::vector<std::string> &columns) const;
+};
+
+// RCU-style holder of the current TreeVersion. Readers grab it with
+// current() and never wait; publishers build the next version off to the
+// side and swap it in atomically.
+class TreeCatalog {
+ public:
+  // With a dbManager, publishing trees that cover a flush releases the
+  // memtable delta writes they now index
+  explicit TreeCatalog(DBManager *dbManager = nullptr)
+      : dbManager_(dbManager) {}
+
+  std::shared_ptr<const TreeVersion> current() const;
+
+  // Replaces all trees, built from files holding the writes up to
+  // flushedSequence; returns the id of the new version
+  uint64_t publish(std::map<std::string, BloomTree> trees,
+                   uint64_t flushedSequence = 0);
+  // Replaces the tree of one column, keeping the others of the current version
+  uint64_t publishColumn(const std::string &column, BloomTree tree);
+
+  // Memory pressure: publishes the current trees with their internal
+  // filters folded to internalBytes per tree; no key is rehashed
+  uint64_t foldToBudget(size_t internalBytes);
+
+  // Builds fresh trees for columns from their current SST files on a
+  // separate thread and publishes them when done
+  std::future<uint64_t> rebuildAsync(DBManager &dbManager,
+                                     BloomManager &bloomManager,
+                                     std::vector<std::string> columns,
+                                     TestParams params);
+
+ private:
+  DBManager *dbManager_;
+  std::atomic<std::shared_ptr<const TreeVersion>> current_;
+  std::mutex publishMutex_;  // orders publishers, never taken by readers
+  uint64_t lastId_ = 0;
+};
+
+#endif  // TREE_CATALOG_HPP
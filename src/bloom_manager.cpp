@@ -2,7 +2,9 @@
 
 #include <rocksdb/sst_file_reader.h>
 #include <spdlog/spdlog.h>
+#include <spdlog/fmt/ranges.h>
 
+#include <atomic>
 #include <future>
 #include <vector>
 #include <boost/asio/thread_pool.hpp>
@@ -14,11 +16,14 @@
 
 extern boost::asio::thread_pool globalThreadPool;
 
-std::vector<Node*> BloomManager::processSSTFile(const std::string& sstFile,
-                                                size_t partitionSize,
-                                                size_t bloomSize,
-                                                int numHashFunctions) {
-    std::vector<Node*> partitions;
+std::vector<Node> BloomManager::processSSTFile(const std::string& sstFile,
+                                               size_t partitionSize,
+                                               size_t bloomSize,
+                                               int numHashFunctions,
+                                               bool buildValueIndex,
+                                               LeafFilterType leafFilterType,
+                                               bool countingLeaves) {
+    std::vector<Node> partitions;
     rocksdb::Options options;
     rocksdb::SstFileReader reader(options);
     auto status = reader.Open(sstFile);
@@ -30,6 +35,13 @@ std::vector<Node*> BloomManager::processSSTFile(const std::string& sstFile,
     auto iter = reader.NewIterator(rocksdb::ReadOptions());
     size_t currentCount = 0;
     BloomFilter partitionBloom(bloomSize, numHashFunctions);
+    PartitionIndex::Builder indexBuilder;
+    bool buildLeafFilter = leafFilterType != LeafFilterType::Bloom;
+    std::vector<uint64_t> keyHashes;
+    std::shared_ptr<CountingBloomFilter> counting;
+    if (countingLeaves) {
+        counting = std::make_shared<CountingBloomFilter>(bloomSize, numHashFunctions);
+    }
     std::string partitionStartKey;
     bool firstEntry = true;
     std::string lastKey;
@@ -44,11 +56,31 @@ std::vector<Node*> BloomManager::processSSTFile(const std::string& sstFile,
         }
 
         partitionBloom.insert(value);
+        if (buildValueIndex) {
+            indexBuilder.add(key, value);
+        }
+        if (buildLeafFilter) {
+            keyHashes.push_back(leafFilterKeyHash(value));
+        }
+        if (countingLeaves) {
+            counting->insert(value);
+        }
         lastKey = key;
         currentCount++;
 
         if (currentCount >= partitionSize) {
-            partitions.push_back(new Node(std::move(partitionBloom), sstFile, partitionStartKey, lastKey));
+            partitions.emplace_back(std::move(partitionBloom), sstFile, partitionStartKey, lastKey);
+            if (buildValueIndex) {
+                partitions.back().valueIndex = std::make_shared<const PartitionIndex>(indexBuilder.build());
+            }
+            if (buildLeafFilter) {
+                partitions.back().leafFilter = makeLeafFilter(leafFilterType, keyHashes);
+                keyHashes.clear();
+            }
+            if (countingLeaves) {
+                partitions.back().counting = std::move(counting);
+                counting = std::make_shared<CountingBloomFilter>(bloomSize, numHashFunctions);
+            }
             partitionBloom = BloomFilter(bloomSize, numHashFunctions);
             currentCount = 0;
             firstEntry = true;
@@ -56,7 +88,16 @@ std::vector<Node*> BloomManager::processSSTFile(const std::string& sstFile,
     }
 
     if (currentCount > 0) {
-        partitions.push_back(new Node(std::move(partitionBloom), sstFile, partitionStartKey, lastKey));
+        partitions.emplace_back(std::move(partitionBloom), sstFile, partitionStartKey, lastKey);
+        if (buildValueIndex) {
+            partitions.back().valueIndex = std::make_shared<const PartitionIndex>(indexBuilder.build());
+        }
+        if (buildLeafFilter) {
+            partitions.back().leafFilter = makeLeafFilter(leafFilterType, keyHashes);
+        }
+        if (countingLeaves) {
+            partitions.back().counting = std::move(counting);
+        }
     }
 
     delete iter;
@@ -67,24 +108,39 @@ BloomTree BloomManager::createPartitionedHierarchy(const std::vector<std::string
                                                    size_t partitionSize,
                                                    size_t bloomSize,
                                                    int numHashFunctions,
-                                                   int branchingRatio) {
+                                                   int branchingRatio,
+                                                   bool buildValueIndex,
+                                                LeafFilterType leafFilterType,
+                                                bool countingLeaves,
+                                                size_t leafCacheBytes,
+                                                double expectedPositiveRate,
+                                                int internalFoldShift,
+                                                bool childSlices) {
     StopWatch sw;
     sw.start();
+    if (countingLeaves && leafFilterType != LeafFilterType::Bloom) {
+        // Static filters cannot take updates; counting leaves need Bloom bits
+        spdlog::warn("Counting leaves requested, ignoring {} leaf filters.", leafFilterTypeName(leafFilterType));
+        leafFilterType = LeafFilterType::Bloom;
+    }
     BloomTree hierarchy(branchingRatio, bloomSize, numHashFunctions);
 
-    std::vector<std::future<std::vector<Node*>>> futures;
+    std::vector<std::future<std::vector<Node>>> futures;
     futures.reserve(sstFiles.size());
 
     for (const auto& sstFile : sstFiles) {
         auto task = std::make_shared<
-            std::packaged_task<std::vector<Node*>()>
+            std::packaged_task<std::vector<Node>()>
         >(
             std::bind(&BloomManager::processSSTFile,
                       this,
                       sstFile,
                       partitionSize,
                       bloomSize,
-                      numHashFunctions)
+                      numHashFunctions,
+                      buildValueIndex,
+                      leafFilterType,
+                      countingLeaves)
         );
 
         futures.emplace_back(task->get_future());
@@ -94,16 +150,48 @@ BloomTree BloomManager::createPartitionedHierarchy(const std::vector<std::string
         );
     }
 
-    std::vector<Node*> allLeafNodes;
+    std::vector<Node> allLeafNodes;
     for (auto& fut : futures) {
-        std::vector<Node*> nodes = fut.get();
-        allLeafNodes.insert(allLeafNodes.end(), nodes.begin(), nodes.end());
+        std::vector<Node> nodes = fut.get();
+        allLeafNodes.insert(allLeafNodes.end(), std::make_move_iterator(nodes.begin()),
+                            std::make_move_iterator(nodes.end()));
     }
 
-    hierarchy.leafNodes = std::move(allLeafNodes);
+    if (buildValueIndex) {
+        size_t indexBytes = 0;
+        for (const Node& leaf : allLeafNodes) {
+            indexBytes += leaf.valueIndex->memorySize();
+        }
+        spdlog::info("Partition value indexes built for {} leaves, {} bytes in memory.", allLeafNodes.size(), indexBytes);
+    }
+
+    hierarchy.adoptLeaves(std::move(allLeafNodes));
+
+    TreeShapeModel shapeModel = hierarchy.shapeModel(expectedPositiveRate);
+    if (branchingRatio <= 0) {
+        hierarchy.setLevelRatios(chooseTreeShape(shapeModel).ratios);
+    }
+    hierarchy.setInternalFoldShift(internalFoldShift);
+    hierarchy.setChildSlices(childSlices);
+    hierarchy.predictedBloomChecks =
+        predictBloomChecks(shapeModel, hierarchy.levelRatios(), hierarchy.branchingRatio());
+    if (!hierarchy.levelRatios().empty()) {
+        spdlog::info("Tree shape: level ratios [{}], predicted {:.1f} bloom checks per query.",
+                     fmt::join(hierarchy.levelRatios(), ","), hierarchy.predictedBloomChecks);
+    }
 
-    hierarchy.buildTree();
+    // One leaf segment per tree; the sequence keeps rebuilds of the same
+    // column from sharing a file
+    static std::atomic<size_t> segmentSeq{0};
+    hierarchy.buildTree(sstFiles.empty() ? "" : sstFiles.front() + ".leaves." + std::to_string(segmentSeq++));
+    if (leafCacheBytes > 0) {
+        hierarchy.pageOutLeaves(leafCacheBytes);
+    }
     sw.stop();
+    hierarchy.buildMicros = sw.elapsedMicros();
+    if (leafFilterType != LeafFilterType::Bloom) {
+        spdlog::info("{} leaf filters: {} bytes in memory.", leafFilterTypeName(leafFilterType), hierarchy.leafMemorySize());
+    }
     spdlog::info("Bloom hierarchy successfully built from partitions using parallel processing in {} µs.", sw.elapsedMicros());
     return hierarchy;
 }
@@ -10,31 +10,54 @@
 
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <algorithm>
 #include <filesystem>
 #include <future>
+#include <optional>
 #include <random>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_set>
+#include <utility>
 
 #include "algorithm.hpp"
 #include "stopwatch.hpp"
+#include "tree_catalog.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
 
+namespace {
+// Keys per MultiGet call when verifying candidates
+constexpr size_t kVerifyBatchSize = 256;
+}  // namespace
+
 void DBManager::compactAllColumnFamilies(size_t numRecords) {
   if (!db_) throw std::runtime_error("DB not open");
   rocksdb::CompactRangeOptions opts;
 
-  auto s_enable_del = db_->EnableFileDeletions(true);
-  if (!s_enable_del.ok()) {
-      spdlog::warn("Failed to ensure file deletions are enabled: {}. DB size may grow.", s_enable_del.ToString());
+  // Pinned query snapshots keep their own deletion guards in place. The
+  // lock is held across the forced enable, which resets every guard, so no
+  // pin can take its guard in between.
+  {
+    std::lock_guard<std::mutex> lock(pinnedMutex_);
+    if (pinnedSnapshots_.empty()) {
+      auto s_enable_del = db_->EnableFileDeletions(true);
+      if (!s_enable_del.ok()) {
+          spdlog::warn("Failed to ensure file deletions are enabled: {}. DB size may grow.", s_enable_del.ToString());
+      }
+    }
   }
 
+  // Writes up to here end up in SST files below; their delta entries stay
+  // until trees built from those files are published
+  uint64_t flushed = db_->GetLatestSequenceNumber();
+  bool allFlushed = true;
   for (auto& kv : cf_handles_) {
     auto* handle = kv.second.get();
     auto s_flush = db_->Flush(rocksdb::FlushOptions(), handle);
     if (!s_flush.ok()) {
         spdlog::error("Flush failed for CF '{}': {}. Skipping compaction for this CF.", kv.first, s_flush.ToString());
+        allFlushed = false;
         continue;
     }
 
@@ -66,6 +89,7 @@ void DBManager::compactAllColumnFamilies(size_t numRecords) {
       }
     }
   }
+  if (allFlushed) flushedSequence_ = flushed;
 
   spdlog::info("Waiting for all background compactions to finish across the DB...");
   rocksdb::WaitForCompactOptions wco;
@@ -113,8 +137,11 @@ void DBManager::openDB(const std::string& dbname,
 
   // Store ColumnFamilyHandles in a map for easy access
   cf_handles_.clear();
+  memtableDeltas_.clear();
+  flushedSequence_ = 0;
   for (size_t i = 0; i < cf_names.size(); ++i) {
     cf_handles_[cf_names[i]].reset(cf_handles_raw[i]);
+    memtableDeltas_[cf_names[i]] = std::make_unique<MemtableDelta>();
   }
 
   sw.stop();
@@ -251,6 +278,26 @@ std::vector<std::string> DBManager::scanSSTFilesForColumn(
   return sst_files;
 }
 
+std::string DBManager::sstFileForKey(const std::string& dbname,
+                                     const std::string& column,
+                                     const std::string& key) {
+  if (!db_) throw std::runtime_error("DB not open.");
+  if (cf_handles_.find(column) == cf_handles_.end())
+    throw std::runtime_error("Unknown Column Family: " + column);
+
+  rocksdb::ColumnFamilyMetaData meta;
+  db_->GetColumnFamilyMetaData(cf_handles_[column].get(), &meta);
+  // Levels top-down, level 0 newest file first: the order reads go in
+  for (const auto& level : meta.levels) {
+    for (const auto& file : level.files) {
+      if (file.smallestkey <= key && key <= file.largestkey) {
+        return dbname + file.name;
+      }
+    }
+  }
+  return "";
+}
+
 bool DBManager::checkValueWithoutBloomFilters(const std::string& value) {
   StopWatch sw;
   sw.start();
@@ -289,7 +336,20 @@ rocksdb::Status DBManager::closeDB() {
   sw.start();
 
   if (db_) {
+    std::map<const rocksdb::Snapshot*, uint64_t> pinned;
+    {
+      std::lock_guard<std::mutex> lock(pinnedMutex_);
+      pinned.swap(pinnedSnapshots_);
+    }
+    if (!pinned.empty()) {
+      spdlog::warn("Closing DB with {} query snapshots still pinned.",
+                   pinned.size());
+    }
+    for (const auto& [snapshot, flushed] : pinned) {
+      db_->ReleaseSnapshot(snapshot);
+    }
     cf_handles_.clear();  // Automatically deletes handles
+    memtableDeltas_.clear();
     db_.reset();
     spdlog::debug("DB closed with Column Families.");
   }
@@ -373,7 +433,7 @@ bool DBManager::noBloomcheckValueInColumn(const std::string& column,
 
 std::vector<std::string> DBManager::scanForRecordsInColumns(
     const std::vector<std::string>& columns,
-    const std::vector<std::string>& values) {
+    const std::vector<std::string>& values, const QuerySnapshot* snapshot) {
   if (columns.size() != values.size() || columns.empty()) {
     throw std::runtime_error(
         "Number of columns and values must be equal and non-empty.");
@@ -391,8 +451,7 @@ std::vector<std::string> DBManager::scanForRecordsInColumns(
                              columns[0]);
   }
 
-  rocksdb::ReadOptions readOptions;
-  readOptions.fill_cache = false;
+  rocksdb::ReadOptions readOptions = queryReadOptions(snapshot);
 
   // Create an iterator for the base column and scan the entire key range.
   std::unique_ptr<rocksdb::Iterator> iter(
@@ -433,7 +492,20 @@ std::vector<std::string> DBManager::scanForRecordsInColumns(
 std::vector<std::string> DBManager::scanFileForKeysWithValue(
     const std::string& filename, const std::string& value,
     const std::string& rangeStart, const std::string& rangeEnd) {
-  std::vector<std::string> matchingKeys;
+  auto matches =
+      scanFileForKeysWithValues(filename, {value}, rangeStart, rangeEnd);
+  auto it = matches.find(value);
+  if (it == matches.end()) return {};
+  return std::move(it->second);
+}
+
+std::unordered_map<std::string, std::vector<std::string>>
+DBManager::scanFileForKeysWithValues(
+    const std::string& filename, const std::unordered_set<std::string>& values,
+    const std::string& rangeStart, const std::string& rangeEnd) {
+  std::unordered_map<std::string, std::vector<std::string>> matchingKeys;
+  if (values.empty()) return matchingKeys;
+
   rocksdb::Options options;
   options.env = rocksdb::Env::Default();
 
@@ -448,6 +520,10 @@ std::vector<std::string> DBManager::scanFileForKeysWithValue(
   rocksdb::ReadOptions readOptions;
   readOptions.fill_cache = false;
 
+  // Probe the targets through views so non-matching rows allocate nothing
+  std::unordered_set<std::string_view> targets(values.begin(), values.end());
+  rocksdb::Slice end(rangeEnd);
+
   auto iter =
       std::unique_ptr<rocksdb::Iterator>(reader.NewIterator(readOptions));
   if (!rangeStart.empty()) {
@@ -457,11 +533,134 @@ std::vector<std::string> DBManager::scanFileForKeysWithValue(
   }
 
   while (iter->Valid()) {
-    std::string currentKey = iter->key().ToString();
-    if (!rangeEnd.empty() && currentKey > rangeEnd) break;
+    rocksdb::Slice currentKey = iter->key();
+    if (!rangeEnd.empty() && currentKey.compare(end) > 0) break;
+
+    rocksdb::Slice currentValue = iter->value();
+    auto hit = targets.find(
+        std::string_view(currentValue.data(), currentValue.size()));
+    if (hit != targets.end()) {
+      matchingKeys[std::string(*hit)].push_back(currentKey.ToString());
+    }
+    iter->Next();
+  }
 
-    if (iter->value().ToString() == value) {
-      matchingKeys.push_back(currentKey);
+  return matchingKeys;
+}
+
+std::unordered_map<std::string, std::vector<std::string>>
+DBManager::scanPartitionForKeysWithValues(
+    const Node& leaf, const std::unordered_set<std::string>& values,
+    const std::string& rangeStart, const std::string& rangeEnd,
+    const QuerySnapshot* snapshot) {
+  if (!leaf.liveColumn.empty()) {
+    return scanColumnRangeForKeysWithValues(leaf.liveColumn, values,
+                                            rangeStart, rangeEnd, snapshot);
+  }
+  if (!leaf.valueIndex) {
+    return scanFileForKeysWithValues(leaf.filename, values, rangeStart,
+                                     rangeEnd);
+  }
+  const PartitionIndex& index = *leaf.valueIndex;
+
+  std::vector<uint32_t> runs;
+  for (const auto& value : values) {
+    auto valueRuns = index.lookup(value);
+    runs.insert(runs.end(), valueRuns.begin(), valueRuns.end());
+  }
+  std::sort(runs.begin(), runs.end());
+  runs.erase(std::unique(runs.begin(), runs.end()), runs.end());
+
+  std::unordered_map<std::string, std::vector<std::string>> matchingKeys;
+  // No fingerprint matched: a bloom false positive, rejected without I/O
+  if (runs.empty()) return matchingKeys;
+
+  rocksdb::Options options;
+  options.env = rocksdb::Env::Default();
+
+  rocksdb::SstFileReader reader(options);
+  auto status = reader.Open(leaf.filename);
+  if (!status.ok()) {
+    spdlog::error("Failed to open SSTable '{}': {}", leaf.filename,
+                  status.ToString());
+    return {};
+  }
+
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+
+  std::unordered_set<std::string_view> targets(values.begin(), values.end());
+  rocksdb::Slice end(rangeEnd);
+  rocksdb::Slice partitionEnd(leaf.endKey);
+
+  auto iter =
+      std::unique_ptr<rocksdb::Iterator>(reader.NewIterator(readOptions));
+  for (size_t r = 0; r < runs.size();) {
+    // Adjacent runs are read in one seek
+    size_t last = r;
+    while (last + 1 < runs.size() && runs[last + 1] == runs[last] + 1) ++last;
+    bool endsPartition = runs[last] + 1 >= index.runCount();
+    rocksdb::Slice stop =
+        endsPartition ? partitionEnd
+                      : rocksdb::Slice(index.runStartKey(runs[last] + 1));
+
+    iter->Seek(std::max(index.runStartKey(runs[r]), rangeStart));
+    while (iter->Valid()) {
+      rocksdb::Slice currentKey = iter->key();
+      int cmp = currentKey.compare(stop);
+      if (cmp > 0 || (cmp == 0 && !endsPartition)) break;
+      if (!rangeEnd.empty() && currentKey.compare(end) > 0) break;
+
+      rocksdb::Slice currentValue = iter->value();
+      auto hit = targets.find(
+          std::string_view(currentValue.data(), currentValue.size()));
+      if (hit != targets.end()) {
+        matchingKeys[std::string(*hit)].push_back(currentKey.ToString());
+      }
+      iter->Next();
+    }
+    r = last + 1;
+  }
+
+  return matchingKeys;
+}
+
+std::unordered_map<std::string, std::vector<std::string>>
+DBManager::scanColumnRangeForKeysWithValues(
+    const std::string& column, const std::unordered_set<std::string>& values,
+    const std::string& rangeStart, const std::string& rangeEnd,
+    const QuerySnapshot* snapshot) {
+  std::unordered_map<std::string, std::vector<std::string>> matchingKeys;
+  if (values.empty()) return matchingKeys;
+
+  auto cf_it = cf_handles_.find(column);
+  if (cf_it == cf_handles_.end()) {
+    spdlog::error("Column family '{}' not found for range scan.", column);
+    return {};
+  }
+
+  rocksdb::ReadOptions readOptions = queryReadOptions(snapshot);
+
+  std::unordered_set<std::string_view> targets(values.begin(), values.end());
+  rocksdb::Slice end(rangeEnd);
+
+  auto iter = std::unique_ptr<rocksdb::Iterator>(
+      db_->NewIterator(readOptions, cf_it->second.get()));
+  if (!rangeStart.empty()) {
+    iter->Seek(rangeStart);
+  } else {
+    iter->SeekToFirst();
+  }
+
+  while (iter->Valid()) {
+    rocksdb::Slice currentKey = iter->key();
+    if (!rangeEnd.empty() && currentKey.compare(end) > 0) break;
+
+    rocksdb::Slice currentValue = iter->value();
+    auto hit = targets.find(
+        std::string_view(currentValue.data(), currentValue.size()));
+    if (hit != targets.end()) {
+      matchingKeys[std::string(*hit)].push_back(currentKey.ToString());
     }
     iter->Next();
   }
@@ -526,7 +725,7 @@ bool DBManager::findRecordInHierarchy(BloomTree& hierarchy,
 
 std::vector<std::string> DBManager::findUsingSingleHierarchy(
     BloomTree& hierarchy, const std::vector<std::string>& columns,
-    const std::vector<std::string>& values) {
+    const std::vector<std::string>& values, const QuerySnapshot* snapshot) {
   if (columns.size() != values.size() || columns.empty()) {
     throw std::runtime_error(
         "Number of columns and values must be equal and non-empty.");
@@ -535,17 +734,20 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
   StopWatch sw;
   sw.start();
 
+  // Count SSTable checks; reset before the early return so a query without
+  // candidates reports none
+  extern std::atomic<size_t> gSSTCheckCount;
+  gSSTCheckCount.store(0);
+  gLeafCacheHitCount = 0;
+  gLeafCacheMissCount = 0;
   std::vector<const Node*> candidates = hierarchy.queryNodes(values[0], "", "");
   if (candidates.empty()) {
     spdlog::info("No candidates found in the hierarchy for '{}'.", values[0]);
-    return {};
+    return applyMemtableDelta(columns, values, {}, snapshot);
   }
 
   std::vector<std::string> allKeys;
 
-  // Count SSTable checks
-  extern std::atomic<size_t> gSSTCheckCount;
-  gSSTCheckCount.store(0);
   gSSTCheckCount += candidates.size();  // Increment by the number of SST files
                                         // we are about to process.
   spdlog::info(
@@ -562,19 +764,23 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
     std::promise<std::vector<std::string>> promise_sst_keys;
     sst_scan_futures.emplace_back(promise_sst_keys.get_future());
 
-    // Capture necessary data by value for the lambda
-    std::string filename = candidate_node->filename;
+    // Capture necessary data by value for the lambda; tree nodes outlive
+    // the query
     std::string value_to_scan = values[0];
-    std::string start_key = candidate_node->startKey;
-    std::string end_key = candidate_node->endKey;
 
     boost::asio::post(globalThreadPool,
-                      [this, filename, value_to_scan, start_key, end_key,
+                      [this, candidate_node, value_to_scan, snapshot,
                        p_sst_keys = std::move(promise_sst_keys)]() mutable {
                         try {
-                          auto keys = scanFileForKeysWithValue(
-                              filename, value_to_scan, start_key, end_key);
-                          p_sst_keys.set_value(keys);
+                          auto matches = scanPartitionForKeysWithValues(
+                              *candidate_node, {value_to_scan},
+                              candidate_node->startKey,
+                              candidate_node->endKey, snapshot);
+                          auto it = matches.find(value_to_scan);
+                          p_sst_keys.set_value(
+                              it == matches.end()
+                                  ? std::vector<std::string>{}
+                                  : std::move(it->second));
                         } catch (...) {
                           try {
                             p_sst_keys.set_exception(std::current_exception());
@@ -597,85 +803,190 @@ std::vector<std::string> DBManager::findUsingSingleHierarchy(
   spdlog::info("Total keys collected from primary column scan: {}",
                allKeys.size());
 
-  std::vector<std::future<std::string>> futures;
-  futures.reserve(allKeys.size());  // Reserve space for futures
+  std::vector<std::string> matchingKeys = applyMemtableDelta(
+      columns, values, verifyKeysInColumns(allKeys, columns, values, snapshot),
+      snapshot);
 
-  for (const auto& key : allKeys) {
-    spdlog::info("Checking key: {}", key.substr(0, 30));
-    std::promise<std::string> promise;
-    futures.emplace_back(promise.get_future());
+  sw.stop();
+  spdlog::critical("Single hierarchy check took {} µs, found {} matching keys.",
+                   sw.elapsedMicros(), matchingKeys.size());
+  spdlog::info(
+      "Bloom filters checked: {} (total), {} (leaves only), SSTables checked: "
+      "{}",
+      gBloomCheckCount.load(), gLeafBloomCheckCount.load(),
+      gSSTCheckCount.load());
+  if (gLeafCacheMissCount.load() > 0) {
+    spdlog::info("Leaf cache hit rate: {:.3f} ({} misses)", leafCacheHitRate(),
+                 gLeafCacheMissCount.load());
+  }
+  return matchingKeys;
+}
 
-    boost::asio::post(globalThreadPool, [this, key, captured_columns = columns,
-                                         captured_values = values,
+std::vector<std::string> DBManager::verifyKeysInColumns(
+    const std::vector<std::string>& allKeys,
+    const std::vector<std::string>& columns,
+    const std::vector<std::string>& values, const QuerySnapshot* snapshot) {
+  if (allKeys.empty()) return {};
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
+  handles.reserve(columns.size());
+  for (const auto& column : columns) {
+    auto cf_it = cf_handles_.find(column);
+    if (cf_it == cf_handles_.end()) {
+      spdlog::warn("Column Family {} not found during key verification.",
+                   column);
+      return {};
+    }
+    handles.push_back(cf_it->second.get());
+  }
+
+  // Sorted input lets MultiGet visit each data block once per batch
+  std::vector<std::string> keys(allKeys);
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // One snapshot for every batch, so all columns are read at the same
+  // version; the query's own snapshot takes precedence
+  const rocksdb::Snapshot* ownSnapshot =
+      snapshot ? nullptr : db_->GetSnapshot();
+  rocksdb::ReadOptions readOptions = queryReadOptions(snapshot);
+  if (ownSnapshot) readOptions.snapshot = ownSnapshot;
+
+  std::vector<char> alive(keys.size(), 1);
+  std::vector<std::future<void>> futures;
+  for (size_t begin = 0; begin < keys.size(); begin += kVerifyBatchSize) {
+    size_t end = std::min(keys.size(), begin + kVerifyBatchSize);
+    std::promise<void> promise;
+    futures.emplace_back(promise.get_future());
+    boost::asio::post(globalThreadPool, [&, begin, end,
                                          p = std::move(promise)]() mutable {
-      rocksdb::ReadOptions readOptionsLocal;
-      readOptionsLocal.fill_cache = false;
-      bool all_columns_match = true;
-
-      if (captured_columns.size() > 1) {
-        for (size_t i = 1; i < captured_columns.size(); ++i) {
-          auto cf_it = cf_handles_.find(captured_columns[i]);
-          if (cf_it == cf_handles_.end()) {
-            spdlog::warn(
-                "Column Family {} not found for key {} during Get operation in "
-                "findUsingSingleHierarchy.",
-                captured_columns[i], key);
-            all_columns_match = false;
-            break;
-          }
-          rocksdb::ColumnFamilyHandle* handle = cf_it->second.get();
-          std::string actual_value;
-          auto status = db_->Get(readOptionsLocal, handle, key, &actual_value);
-
-          if (!status.ok()) {
-            if (status.IsNotFound()) {
-              spdlog::debug(
-                  "Key {} not found in column {} during Get operation.", key,
-                  captured_columns[i]);
-            } else {
-              spdlog::warn("RocksDB Get failed for key {} in column {}: {}",
-                           key, captured_columns[i], status.ToString());
+      std::vector<size_t> pending;
+      std::vector<rocksdb::Slice> slices;
+      for (size_t j = 0; j < columns.size(); ++j) {
+        pending.clear();
+        slices.clear();
+        for (size_t i = begin; i < end; ++i) {
+          if (!alive[i]) continue;
+          pending.push_back(i);
+          slices.emplace_back(keys[i]);
+        }
+        if (pending.empty()) break;
+
+        std::vector<rocksdb::PinnableSlice> found(pending.size());
+        std::vector<rocksdb::Status> statuses(pending.size());
+        db_->MultiGet(readOptions, handles[j], pending.size(), slices.data(),
+                      found.data(), statuses.data(), true);
+        rocksdb::Slice expected(values[j]);
+        for (size_t k = 0; k < pending.size(); ++k) {
+          if (!statuses[k].ok()) {
+            if (!statuses[k].IsNotFound()) {
+              spdlog::warn("RocksDB MultiGet failed for key {} in column {}: {}",
+                           keys[pending[k]], columns[j],
+                           statuses[k].ToString());
             }
-            all_columns_match = false;
-            break;
-          }
-          if (actual_value != captured_values[i]) {
-            all_columns_match = false;
-            break;
+            alive[pending[k]] = 0;
+          } else if (found[k].compare(expected) != 0) {
+            alive[pending[k]] = 0;
           }
         }
       }
-      // If all_columns_match is still true, it means:
-      // 1. There was only one column (already verified by
-      // scanFileForKeysWithValue), OR
-      // 2. All subsequent columns also matched their respective values for the
-      // given key.
-      if (all_columns_match) {
-        p.set_value(key);
-      } else {
-        p.set_value(std::string());  // Indicate no match with an empty string
-      }
+      p.set_value();
     });
   }
+  for (auto& fut : futures) fut.get();
+  if (ownSnapshot) db_->ReleaseSnapshot(ownSnapshot);
 
-  // Wait for all asynchronous tasks to finish and collect matching keys.
   std::vector<std::string> matchingKeys;
-  for (auto& fut : futures) {
-    std::string res = fut.get();
-    if (!res.empty()) {
-      matchingKeys.push_back(res);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (alive[i]) matchingKeys.push_back(std::move(keys[i]));
+  }
+  return matchingKeys;
+}
+
+std::vector<std::vector<std::string>> DBManager::findUsingSingleHierarchyBatch(
+    BloomTree& hierarchy, const std::vector<std::string>& columns,
+    const std::vector<std::vector<std::string>>& valueRows,
+    const QuerySnapshot* snapshot) {
+  if (columns.empty()) {
+    throw std::runtime_error("Number of columns must be non-empty.");
+  }
+  for (const auto& row : valueRows) {
+    if (row.size() != columns.size()) {
+      throw std::runtime_error(
+          "Number of columns and values must be equal for every query.");
+    }
+  }
+
+  StopWatch sw;
+  sw.start();
+
+  std::vector<std::string> primaryValues;
+  primaryValues.reserve(valueRows.size());
+  for (const auto& row : valueRows) primaryValues.push_back(row[0]);
+
+  // Group the primary values by candidate leaf: one pass per partition
+  std::vector<std::vector<const Node*>> candidates =
+      hierarchy.queryBatch(primaryValues, "", "");
+  std::unordered_map<const Node*, std::unordered_set<std::string>> leafValues;
+  for (size_t q = 0; q < candidates.size(); ++q) {
+    for (const Node* leaf : candidates[q]) {
+      leafValues[leaf].insert(primaryValues[q]);
     }
   }
 
+  extern std::atomic<size_t> gSSTCheckCount;
+  gSSTCheckCount.store(0);
+  gSSTCheckCount += leafValues.size();
+
+  using ValueKeys = std::unordered_map<std::string, std::vector<std::string>>;
+  std::vector<std::future<ValueKeys>> sst_scan_futures;
+  sst_scan_futures.reserve(leafValues.size());
+  for (const auto& [leaf, targets] : leafValues) {
+    std::promise<ValueKeys> promise_sst_keys;
+    sst_scan_futures.emplace_back(promise_sst_keys.get_future());
+    boost::asio::post(globalThreadPool,
+                      [this, leaf, targets = targets, snapshot,
+                       p_sst_keys = std::move(promise_sst_keys)]() mutable {
+                        try {
+                          p_sst_keys.set_value(scanPartitionForKeysWithValues(
+                              *leaf, targets, leaf->startKey, leaf->endKey,
+                              snapshot));
+                        } catch (...) {
+                          try {
+                            p_sst_keys.set_exception(std::current_exception());
+                          } catch (...) {
+                          }
+                        }
+                      });
+  }
+
+  ValueKeys keysByValue;
+  for (auto& fut_sst_keys : sst_scan_futures) {
+    try {
+      for (auto& [value, keys] : fut_sst_keys.get()) {
+        auto& dst = keysByValue[value];
+        dst.insert(dst.end(), keys.begin(), keys.end());
+      }
+    } catch (const std::exception& e) {
+      spdlog::error("Exception during parallel SST scan: {}", e.what());
+    }
+  }
+
+  std::vector<std::vector<std::string>> results(valueRows.size());
+  for (size_t q = 0; q < valueRows.size(); ++q) {
+    auto it = keysByValue.find(valueRows[q][0]);
+    if (it != keysByValue.end()) {
+      results[q] =
+          verifyKeysInColumns(it->second, columns, valueRows[q], snapshot);
+    }
+    results[q] = applyMemtableDelta(columns, valueRows[q], results[q], snapshot);
+  }
+
   sw.stop();
-  spdlog::critical("Single hierarchy check took {} µs, found {} matching keys.",
-                   sw.elapsedMicros(), matchingKeys.size());
-  spdlog::info(
-      "Bloom filters checked: {} (total), {} (leaves only), SSTables checked: "
-      "{}",
-      gBloomCheckCount.load(), gLeafBloomCheckCount.load(),
-      gSSTCheckCount.load());
-  return matchingKeys;
+  spdlog::critical(
+      "Batched single hierarchy check of {} queries took {} µs, scanned {} "
+      "partitions.",
+      valueRows.size(), sw.elapsedMicros(), leafValues.size());
+  return results;
 }
 
 std::string DBManager::getValue(const std::string& column_family_name,
@@ -706,10 +1017,9 @@ rocksdb::ColumnFamilyHandle* DBManager::getColumnFamilyHandle(
 
 rocksdb::Status DBManager::applyModifications(
     const std::vector<std::tuple<std::string, std::string, std::string>>&
-        modifications, size_t numRecords) {
+        modifications, size_t numRecords, bool compact) {
   if (!db_) return rocksdb::Status::InvalidArgument("DB not open");
 
-  rocksdb::WriteOptions write_options;
   for (const auto& mod : modifications) {
     const std::string& key = std::get<0>(mod);
     const std::string& column_name = std::get<1>(mod);
@@ -723,7 +1033,7 @@ rocksdb::Status DBManager::applyModifications(
           column_name, key);
       continue;
     }
-    rocksdb::Status s = db_->Put(write_options, handle, key, value);
+    rocksdb::Status s = putTracked(column_name, handle, key, value);
     if (!s.ok()) {
       spdlog::error(
           "ApplyModifications: Failed to Put key '{}' in column '{}': {}", key,
@@ -731,16 +1041,15 @@ rocksdb::Status DBManager::applyModifications(
       return s;
     }
   }
-  compactAllColumnFamilies(numRecords);
+  if (compact) compactAllColumnFamilies(numRecords);
   return rocksdb::Status::OK();
 }
 
 rocksdb::Status DBManager::revertModifications(
     const std::vector<std::tuple<std::string, std::string, std::string>>&
-        reversions, size_t numRecords) {
+        reversions, size_t numRecords, bool compact) {
   if (!db_) return rocksdb::Status::InvalidArgument("DB not open");
 
-  rocksdb::WriteOptions write_options;
   for (const auto& rev : reversions) {
     const std::string& key = std::get<0>(rev);
     const std::string& column_name = std::get<1>(rev);
@@ -754,7 +1063,7 @@ rocksdb::Status DBManager::revertModifications(
           column_name, key);
       continue;
     }
-    rocksdb::Status s = db_->Put(write_options, handle, key, value);
+    rocksdb::Status s = putTracked(column_name, handle, key, value);
     if (!s.ok()) {
       spdlog::error(
           "RevertModifications: Failed to Put key '{}' in column '{}': {}", key,
@@ -762,6 +1071,180 @@ rocksdb::Status DBManager::revertModifications(
       return s;
     }
   }
-  compactAllColumnFamilies(numRecords);
+  if (compact) compactAllColumnFamilies(numRecords);
   return rocksdb::Status::OK();
 }
+
+rocksdb::Status DBManager::putTracked(const std::string& column,
+                                      rocksdb::ColumnFamilyHandle* handle,
+                                      const std::string& key,
+                                      const std::string& value) {
+  // One tracked write at a time, so the latest sequence is this write's
+  std::lock_guard lock(trackedWriteMutex_);
+  rocksdb::Status s = db_->Put(rocksdb::WriteOptions(), handle, key, value);
+  if (s.ok()) {
+    auto delta = memtableDeltas_.find(column);
+    if (delta != memtableDeltas_.end()) {
+      delta->second->recordWrite(key, value, db_->GetLatestSequenceNumber());
+    }
+  }
+  return s;
+}
+
+void DBManager::releaseMemtableDeltas(uint64_t sequence) {
+  // A pinned query reads trees that may not cover the writes up to sequence
+  {
+    std::lock_guard<std::mutex> lock(pinnedMutex_);
+    for (const auto& [snapshot, flushed] : pinnedSnapshots_) {
+      sequence = std::min(sequence, flushed);
+    }
+  }
+  for (auto& [column, delta] : memtableDeltas_) delta->releaseThrough(sequence);
+}
+
+const MemtableDelta* DBManager::memtableDelta(const std::string& column) const {
+  auto it = memtableDeltas_.find(column);
+  return it == memtableDeltas_.end() ? nullptr : it->second.get();
+}
+
+std::vector<std::string> DBManager::applyMemtableDelta(
+    const std::vector<std::string>& columns,
+    const std::vector<std::string>& values,
+    const std::vector<std::string>& treeMatches,
+    const QuerySnapshot* snapshot) {
+  std::vector<const MemtableDelta*> deltas(columns.size(), nullptr);
+  bool anyWrites = false;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const MemtableDelta* delta = memtableDelta(columns[i]);
+    if (delta && !delta->empty()) {
+      deltas[i] = delta;
+      anyWrites = true;
+    }
+  }
+  if (!anyWrites) return treeMatches;
+
+  // Tree matches untouched since the flush still hold; everything the delta
+  // touched is read again. Writes newer than the query snapshot are skipped.
+  uint64_t sequence =
+      snapshot ? snapshot->sequenceNumber() : MemtableDelta::kLatest;
+  std::vector<std::string> matchingKeys;
+  std::vector<std::string> touched;
+  for (const auto& key : treeMatches) {
+    bool changed = false;
+    for (size_t j = 0; j < columns.size() && !changed; ++j) {
+      changed = deltas[j] && deltas[j]->latestValue(key, sequence).has_value();
+    }
+    (changed ? touched : matchingKeys).push_back(key);
+  }
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (!deltas[i]) continue;
+    auto keys = deltas[i]->keysWithValue(values[i], sequence);
+    touched.insert(touched.end(), std::make_move_iterator(keys.begin()),
+                   std::make_move_iterator(keys.end()));
+  }
+
+  for (auto& key : verifyKeysInColumns(touched, columns, values, snapshot)) {
+    matchingKeys.push_back(std::move(key));
+  }
+  return matchingKeys;
+}
+
+DBManager::QuerySnapshot::QuerySnapshot(QuerySnapshot&& other) noexcept
+    : owner_(std::exchange(other.owner_, nullptr)),
+      snapshot_(std::exchange(other.snapshot_, nullptr)),
+      version_(std::move(other.version_)) {}
+
+DBManager::QuerySnapshot::~QuerySnapshot() {
+  if (owner_) owner_->releaseQuerySnapshot(snapshot_);
+}
+
+uint64_t DBManager::QuerySnapshot::sequenceNumber() const {
+  return snapshot_ ? snapshot_->GetSequenceNumber() : 0;
+}
+
+DBManager::QuerySnapshot DBManager::pinQuerySnapshot(
+    std::shared_ptr<const TreeVersion> version) {
+  if (!db_) throw std::runtime_error("DB not open");
+  if (!version) throw std::runtime_error("No tree version to pin.");
+
+  // Registered before the guard is taken, so a compaction cannot force
+  // deletions back on while the files are being checked
+  const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
+  {
+    std::lock_guard<std::mutex> lock(pinnedMutex_);
+    pinnedSnapshots_[snapshot] = version->flushedSequence;
+  }
+  auto unregister = [&] {
+    {
+      std::lock_guard<std::mutex> lock(pinnedMutex_);
+      pinnedSnapshots_.erase(snapshot);
+    }
+    db_->ReleaseSnapshot(snapshot);
+  };
+
+  // Guard first, then list: a file missing from the list can no longer
+  // disappear after the check. Guards stack, one per pinned query.
+  auto s_disable = db_->DisableFileDeletions();
+  if (!s_disable.ok()) {
+    unregister();
+    throw std::runtime_error("Failed to disable file deletions: " +
+                             s_disable.ToString());
+  }
+  std::vector<rocksdb::LiveFileMetaData> liveFiles;
+  db_->GetLiveFilesMetaData(&liveFiles);
+  std::unordered_set<std::string> liveNames;
+  for (const auto& file : liveFiles) {
+    liveNames.insert(std::filesystem::path(file.name).filename().string());
+  }
+
+  for (const auto& [column, tree] : version->trees) {
+    std::vector<const Node*> stack{tree.root};
+    while (!stack.empty()) {
+      const Node* node = stack.back();
+      stack.pop_back();
+      if (!node) continue;
+      stack.insert(stack.end(), node->children.begin(), node->children.end());
+      // Leaves kept up to date in place read through the DB, not the file
+      if (!node->children.empty() || !node->liveColumn.empty()) continue;
+      std::string name =
+          std::filesystem::path(node->filename).filename().string();
+      if (!liveNames.count(name)) {
+        unregister();
+        db_->EnableFileDeletions(false);
+        throw std::runtime_error("Tree for column " + column +
+                                 " refers to SST file " + node->filename +
+                                 " that is no longer live; rebuild it.");
+      }
+    }
+  }
+
+  spdlog::info(
+      "Pinned query snapshot at sequence {} (tree version {}) over {} live "
+      "SST files.",
+      snapshot->GetSequenceNumber(), version->id, liveFiles.size());
+  return QuerySnapshot(this, snapshot, std::move(version));
+}
+
+void DBManager::releaseQuerySnapshot(const rocksdb::Snapshot* snapshot) {
+  {
+    std::lock_guard<std::mutex> lock(pinnedMutex_);
+    // Already released by closeDB
+    if (!snapshot || !pinnedSnapshots_.erase(snapshot)) return;
+  }
+  if (!db_) return;
+  db_->ReleaseSnapshot(snapshot);
+  // Drops only this guard; deletions resume once no other guard holds them
+  auto s_enable = db_->EnableFileDeletions(false);
+  if (!s_enable.ok()) {
+    spdlog::warn("Failed to re-enable file deletions: {}",
+                 s_enable.ToString());
+  }
+}
+
+rocksdb::ReadOptions DBManager::queryReadOptions(
+    const QuerySnapshot* snapshot) {
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+  readOptions.snapshot = snapshot ? snapshot->snapshot() : nullptr;
+  return readOptions;
+}
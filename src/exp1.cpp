@@ -10,6 +10,7 @@
 #include <future>
 #include <iostream>
 #include <map>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
@@ -75,6 +76,71 @@ void writeExp1TimingComparisonHeaders() {
                  "avgHierarchicalMultiTime,avgHierarchicalSingleTime");
 }
 
+void writeExp1BatchQueryHeaders() {
+  writeCsvHeader("csv/exp_1_batch_queries.csv",
+                 "dbSize,batchSize,realQueries,singleLoopTime,batchTime,"
+                 "singleSSTChecks,batchSSTChecks,matches");
+}
+
+// The same queries through findUsingSingleHierarchy one by one and through
+// findUsingSingleHierarchyBatch, which scans each candidate partition once
+void runExp1BatchQueries(DBManager& dbManager,
+                         std::map<std::string, BloomTree>& hierarchies,
+                         const std::vector<std::string>& columns, int dbSize) {
+  const size_t batchSize = 100;
+  std::mt19937 generator(std::random_device{}());
+  std::uniform_int_distribution<int> distribution(1, dbSize);
+
+  std::vector<std::vector<std::string>> valueRows;
+  valueRows.reserve(batchSize);
+  size_t realQueries = 0;
+  for (size_t q = 0; q < batchSize; ++q) {
+    bool real = q % 2 == 0;
+    std::string id = std::to_string(distribution(generator));
+    std::vector<std::string> row;
+    for (const auto& column : columns) {
+      row.push_back(column + (real ? "_value" : "_wrong") + id);
+    }
+    realQueries += real;
+    valueRows.push_back(std::move(row));
+  }
+
+  BloomTree& tree = hierarchies.at(columns[0]);
+  StopWatch sw;
+  size_t singleSSTChecks = 0;
+  size_t singleMatches = 0;
+  sw.start();
+  for (const auto& row : valueRows) {
+    singleMatches +=
+        dbManager.findUsingSingleHierarchy(tree, columns, row).size();
+    singleSSTChecks += gSSTCheckCount.load();
+  }
+  sw.stop();
+  auto singleLoopTime = sw.elapsedMicros();
+
+  sw.start();
+  std::vector<std::vector<std::string>> batchResults =
+      dbManager.findUsingSingleHierarchyBatch(tree, columns, valueRows);
+  sw.stop();
+  auto batchTime = sw.elapsedMicros();
+  size_t batchSSTChecks = gSSTCheckCount.load();
+  size_t batchMatches = 0;
+  for (const auto& matches : batchResults) batchMatches += matches.size();
+  if (batchMatches != singleMatches) {
+    spdlog::warn("EXP1: batch found {} matches, single queries found {}.",
+                 batchMatches, singleMatches);
+  }
+
+  std::ofstream out("csv/exp_1_batch_queries.csv", std::ios::app);
+  if (!out) {
+    spdlog::error("EXP1: Nie udało się otworzyć pliku wynikowego!");
+    return;
+  }
+  out << dbSize << "," << batchSize << "," << realQueries << ","
+      << singleLoopTime << "," << batchTime << "," << singleSSTChecks << ","
+      << batchSSTChecks << "," << batchMatches << "\n";
+}
+
 void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
              int defaultNumRecords, bool skipDbScan) {
   writeCsvHeaders();
@@ -85,6 +151,7 @@ void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
   writeExp1PerColumnHeaders();
   writeExp1MixedQueryHeaders();
   writeExp1TimingComparisonHeaders();
+  writeExp1BatchQueryHeaders();
 
   const std::vector<std::string> columns = {"phone", "mail", "address"};
   const std::vector<int> dbSizes = {10'000'000, 15'000'000, defaultNumRecords};
@@ -146,7 +213,7 @@ void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
     out << params.numRecords << "," << params.bloomTreeRatio << ","
         << params.itemsPerPartition << "," << params.bloomSize << ","
         << params.numHashFunctions << ","
-        << hierarchies.at(columns[0]).leafNodes.size() << ","
+        << hierarchies.at(columns[0]).leafNodes().size() << ","
         << totalDiskBloomSize << "," << totalMemoryBloomSize << "\n";
     out.close();
     spdlog::info("ExpBloomMetrics: Eksperyment dla bazy '{}' zakończony.",
@@ -210,6 +277,8 @@ void runExp1(std::string baseDir, bool initMode, std::string sharedDbName,
     }
     pattern_timings.close();
 
+    runExp1BatchQueries(dbManager, hierarchies, columns, dbSize);
+
     // Run comprehensive analysis across different real data percentages
     const int numQueriesPerScenario = 100;
     
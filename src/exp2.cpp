@@ -10,6 +10,7 @@
 #include <future>
 #include <iostream>
 #include <map>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
@@ -19,10 +20,98 @@
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
 #include "exp_utils.hpp"
+#include "stopwatch.hpp"
 
 extern void clearBloomFilterFiles(const std::string& dbDir);
 extern boost::asio::thread_pool globalThreadPool;
 
+struct PointQueryCost {
+  double bloomChecks = 0.0;
+  double micros = 0.0;
+};
+
+// Bloom checks and time per point query on one column's tree; half of the
+// values are in the column, as the shape model assumes
+static PointQueryCost measurePointQueries(const BloomTree& tree,
+                                          const std::string& column,
+                                          size_t dbSize) {
+  const int numQueries = 200;
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<size_t> distribution(1, dbSize);
+  std::vector<std::string> values;
+  values.reserve(numQueries);
+  for (int q = 0; q < numQueries; ++q) {
+    values.push_back(
+        q % 2 == 0 ? column + "_value" + std::to_string(distribution(generator))
+                   : column + "_missing" + std::to_string(q));
+  }
+  std::vector<uint32_t> leaves;
+  gBloomCheckCount = 0;
+  StopWatch sw;
+  sw.start();
+  for (const auto& value : values) tree.queryLeaves(value, "", "", leaves);
+  sw.stop();
+  return {static_cast<double>(gBloomCheckCount.load()) / numQueries,
+          static_cast<double>(sw.elapsedMicros()) / numQueries};
+}
+
+// Measured bloom checks per point query against the shape model's
+// prediction
+static void writeTreeShapeRows(const std::map<std::string, BloomTree>& hierarchies,
+                               size_t dbSize, size_t items, int ratio) {
+  std::ofstream out("csv/exp_2_tree_shape.csv", std::ios::app);
+  if (!out) {
+    spdlog::error("Exp2: Nie udało się otworzyć pliku wynikowego!");
+    return;
+  }
+  for (const auto& [column, tree] : hierarchies) {
+    std::string levelRatios;
+    for (int r : tree.levelRatios()) {
+      levelRatios += (levelRatios.empty() ? "" : "-") + std::to_string(r);
+    }
+    out << dbSize << "," << items << "," << column << "," << ratio << ","
+        << (levelRatios.empty() ? std::to_string(ratio) : levelRatios) << ","
+        << tree.predictedBloomChecks << ","
+        << measurePointQueries(tree, column, dbSize).bloomChecks << "\n";
+  }
+}
+
+// Internal filter bytes against bloom checks for one folding setting
+static void writeFoldingRow(const std::map<std::string, BloomTree>& hierarchies,
+                            size_t dbSize, size_t items, const TestParams& params) {
+  size_t internalBytes = 0;
+  double checks = 0.0;
+  for (const auto& [column, tree] : hierarchies) {
+    internalBytes += tree.memorySize();
+    checks += measurePointQueries(tree, column, dbSize).bloomChecks;
+  }
+  std::ofstream out("csv/exp_2_folding.csv", std::ios::app);
+  if (out) {
+    out << dbSize << "," << items << "," << params.internalFoldShift << ","
+        << params.internalBytesBudget << "," << internalBytes << ","
+        << checks / hierarchies.size() << "\n";
+  }
+}
+
+// Point query time with and without bit-sliced child filters
+static void writeChildSliceRow(const std::map<std::string, BloomTree>& hierarchies,
+                               size_t dbSize, size_t items, const TestParams& params) {
+  size_t sliceBytes = 0;
+  PointQueryCost cost;
+  for (const auto& [column, tree] : hierarchies) {
+    sliceBytes += tree.stats().childSliceBytes;
+    PointQueryCost c = measurePointQueries(tree, column, dbSize);
+    cost.bloomChecks += c.bloomChecks / hierarchies.size();
+    cost.micros += c.micros / hierarchies.size();
+  }
+  std::ofstream out("csv/exp_2_child_slices.csv", std::ios::app);
+  if (out) {
+    out << dbSize << "," << items << "," << params.bloomTreeRatio << ","
+        << params.childSlices << "," << sliceBytes << "," << cost.bloomChecks
+        << "," << cost.micros << "\n";
+  }
+}
+
 TestParams buildParams(const std::string& dbName, size_t items, size_t dbSize) {
   return TestParams{
       dbName,
@@ -78,12 +167,83 @@ void runExp2(const std::string& dbPath, size_t dbSize) {
       return;
     }
     out << dbSize << "," << items << ","
-        << hierarchies.at(columns[0]).leafNodes.size() << ","
+        << hierarchies.at(columns[0]).leafNodes().size() << ","
         << getProbabilityOfFalsePositive(params.bloomSize,
                                          params.numHashFunctions,
                                          params.itemsPerPartition)
         << "," << totalDiskBloomSize << "," << totalMemoryBloomSize << "\n";
     out.close();
+    appendTreeStats("csv/exp_2_tree_stats.csv", dbSize, items, hierarchies);
+
+    // Fixed ratio against the per-level ratios picked by the cost model
+    writeTreeShapeRows(hierarchies, dbSize, items, params.bloomTreeRatio);
+    {
+      TestParams shapedParams = params;
+      shapedParams.bloomTreeRatio = 0;
+      writeTreeShapeRows(
+          buildHierarchies(columnSstFiles, bloomManager, shapedParams), dbSize,
+          items, shapedParams.bloomTreeRatio);
+    }
+
+    // Parents folded below their children at build time, then the full
+    // tree folded online to half of its internal bytes
+    writeFoldingRow(hierarchies, dbSize, items, params);
+    for (int shift : {1, 2}) {
+      TestParams foldParams = params;
+      foldParams.internalFoldShift = shift;
+      writeFoldingRow(buildHierarchies(columnSstFiles, bloomManager, foldParams),
+                      dbSize, items, foldParams);
+    }
+    {
+      TestParams budgetParams = params;
+      budgetParams.internalBytesBudget =
+          totalMemoryBloomSize / hierarchies.size() / 2;
+      writeFoldingRow(
+          buildHierarchies(columnSstFiles, bloomManager, budgetParams), dbSize,
+          items, budgetParams);
+    }
+
+    // Child slices pay off with wide fanouts
+    for (int ratio : {3, 16}) {
+      for (bool slices : {false, true}) {
+        TestParams sliceParams = params;
+        sliceParams.bloomTreeRatio = ratio;
+        sliceParams.childSlices = slices;
+        writeChildSliceRow(
+            buildHierarchies(columnSstFiles, bloomManager, sliceParams),
+            dbSize, items, sliceParams);
+      }
+    }
+
+    // Leaf level alone per leaf filter type; internal nodes are Bloom in all
+    // of them, so memoryBloomSize above stays the same.
+    for (LeafFilterType type :
+         {LeafFilterType::Bloom, LeafFilterType::BinaryFuse8,
+          LeafFilterType::Ribbon8, LeafFilterType::Ribbon16}) {
+      std::map<std::string, BloomTree> leafHierarchies;
+      if (type == LeafFilterType::Bloom) {
+        leafHierarchies = hierarchies;
+      } else {
+        TestParams leafParams = params;
+        leafParams.leafFilterType = type;
+        leafHierarchies =
+            buildHierarchies(columnSstFiles, bloomManager, leafParams);
+      }
+      size_t leafMemory = 0;
+      long long buildMicros = 0;
+      for (const auto& [column, tree] : leafHierarchies) {
+        leafMemory += tree.leafMemorySize();
+        buildMicros += tree.buildMicros;
+      }
+      double bytesPerKey = static_cast<double>(leafMemory) /
+                           (static_cast<double>(dbSize) * columns.size());
+      std::ofstream leafOut("csv/exp_2_leaf_filters.csv", std::ios::app);
+      if (leafOut) {
+        leafOut << dbSize << "," << items << "," << leafFilterTypeName(type)
+                << "," << leafMemory << "," << bytesPerKey << ","
+                << buildMicros << "," << totalMemoryBloomSize << "\n";
+      }
+    }
   }
   spdlog::info("ExpBloomMetrics: Closing database '{}'.", dbPath);
   dbManager.closeDB();  // Close DB once after all iterations
@@ -92,4 +252,17 @@ void runExp2(const std::string& dbPath, size_t dbSize) {
 void writeCSVheaders() {
   writeCsvHeader("csv/exp_2_bloom_metrics.csv", 
                  "dbSize,itemsPerPartition,leafs,falsePositive,diskBloomSize,memoryBloomSize");
+  writeCsvHeader("csv/exp_2_leaf_filters.csv",
+                 "dbSize,itemsPerPartition,leafFilter,leafMemoryBytes,"
+                 "bytesPerKey,buildMicros,memoryBloomSize");
+  writeTreeStatsHeader("csv/exp_2_tree_stats.csv");
+  writeCsvHeader("csv/exp_2_tree_shape.csv",
+                 "dbSize,itemsPerPartition,column,bloomTreeRatio,levelRatios,"
+                 "predictedBloomChecks,measuredBloomChecks");
+  writeCsvHeader("csv/exp_2_child_slices.csv",
+                 "dbSize,itemsPerPartition,bloomTreeRatio,childSlices,"
+                 "childSliceBytes,bloomChecksPerQuery,microsPerQuery");
+  writeCsvHeader("csv/exp_2_folding.csv",
+                 "dbSize,itemsPerPartition,internalFoldShift,"
+                 "internalBytesBudget,internalBytes,bloomChecksPerQuery");
 }
\ No newline at end of file
@@ -93,6 +93,7 @@ void runExp3(std::string baseDir, bool initMode, std::string sharedDbName,
       BloomTree hierarchy = bloomManager.createPartitionedHierarchy(
           sstFiles, params.itemsPerPartition, params.bloomSize,
           params.numHashFunctions, params.bloomTreeRatio);
+      hierarchy.column = column;
       spdlog::info("Hierarchy built for column: {}", column);
       hierarchies.try_emplace(column, std::move(hierarchy));
     }
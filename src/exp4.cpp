@@ -18,19 +18,9 @@
 #include "db_manager.hpp"
 #include "stopwatch.hpp"
 #include "algorithm.hpp"
+#include "test_params.hpp"
 
 
-
-struct TestParams {
-    std::string dbName;
-    int numRecords;
-    int bloomTreeRatio;
-    int numberOfAttempts;
-    size_t itemsPerPartition;
-    size_t bloomSize;
-    int numHashFunctions;
-};
-
 extern void clearBloomFilterFiles(const std::string& dbDir);
 extern std::atomic<size_t> gBloomCheckCount;
 extern boost::asio::thread_pool globalThreadPool;
@@ -83,6 +73,7 @@ void runExp4(std::string baseDir, bool initMode) {
         for (const auto& [column, sstFiles] : columnSstFiles) {
             BloomTree hierarchy = bloomManager.createPartitionedHierarchy(
                 sstFiles, params.itemsPerPartition, params.bloomSize, params.numHashFunctions, params.bloomTreeRatio);
+            hierarchy.column = column;
             spdlog::info("Hierarchy built for column: {}", column);
             hierarchies.try_emplace(column, std::move(hierarchy));
         }
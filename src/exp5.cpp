@@ -84,6 +84,7 @@ void runExp5(const std::string& dbPath, size_t dbSizeParam, bool skipDbScan) {
   writeExp5RealDataPerColumnHeaders();
   writeExp5PartitionEfficiencyHeaders();
   writeExp5TimingComparisonHeaders();
+  writeTreeStatsHeader("csv/exp_5_tree_stats.csv");
 
   DBManager dbManager;
   BloomManager bloomManager;
@@ -117,7 +118,9 @@ void runExp5(const std::string& dbPath, size_t dbSizeParam, bool skipDbScan) {
       totalDiskBloomSize += tree.diskSize();
       totalMemoryBloomSize += tree.memorySize();
     }
-    int leafs = hierarchies.at(columns[0]).leafNodes.size();
+    int leafs = hierarchies.at(columns[0]).leafNodes().size();
+    appendTreeStats("csv/exp_5_tree_stats.csv", dbSizeParam,
+                    currentItemsPerPartition, hierarchies);
 
     // Write basic performance metrics
     std::ofstream basic_timings("csv/exp_5_basic_timings.csv", std::ios::app);
@@ -70,6 +70,42 @@ void writeExp6TimingComparisonHeaders() {
                  "avgHierarchicalMultiTime,avgHierarchicalSingleTime");
 }
 
+void writeExp6LeafFiltersHeaders() {
+  writeCsvHeader("csv/exp_6_leaf_filters.csv",
+                 "numRecords,bloomSize,leafFilter,leafMemoryBytes,bytesPerKey,"
+                 "falsePositiveProbability,leafProbeNanos,"
+                 "hierarchicalSingleTime,hierarchicalMultiTime");
+}
+
+void writeExp6TieredHeaders() {
+  writeCsvHeader("csv/exp_6_tiered.csv",
+                 "numRecords,bloomSize,cacheFraction,leafCacheBytes,"
+                 "leafMemoryBytes,leafCacheHitRate,"
+                 "hierarchicalSingleTime,hierarchicalMultiTime");
+}
+
+// Average time of one leaf probe with values absent from the database
+static double measureLeafProbeNanos(const BloomTree& tree) {
+  const int numProbeValues = 1000;
+  std::vector<std::string> probes;
+  probes.reserve(numProbeValues);
+  for (int i = 0; i < numProbeValues; ++i) {
+    probes.push_back("leaf_probe_" + std::to_string(i));
+  }
+  size_t passed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const Node* leaf : tree.leafNodes()) {
+    for (const auto& value : probes) {
+      passed += leaf->mayContain(value);
+    }
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start);
+  size_t probesDone = tree.leafNodes().size() * probes.size();
+  spdlog::debug("Exp6: {} of {} leaf probes passed", passed, probesDone);
+  return probesDone == 0 ? 0.0 : elapsed.count() / probesDone;
+}
+
 void runExp6(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
   const std::vector<std::string> columns = {"phone", "mail", "address"};
   const std::vector<size_t> bloomSizes = {2000000, 4000000, 8000000};
@@ -83,6 +119,8 @@ void runExp6(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
   writeExp6RealDataPerColumnHeaders();
   writeExp6SizeEfficiencyHeaders();
   writeExp6TimingComparisonHeaders();
+  writeExp6LeafFiltersHeaders();
+  writeExp6TieredHeaders();
 
   DBManager dbManager;
   BloomManager bloomManager;
@@ -201,6 +239,78 @@ void runExp6(const std::string& dbPath, size_t dbSize, bool skipDbScan) {
     size_efficiency.close();
     timing_comparison.close();
 
+    // Static leaf filters against the Bloom leaves of the same bloom size;
+    // internal nodes stay Bloom, so only the leaf level changes.
+    auto writeLeafFilterRow = [&](LeafFilterType type,
+                                  const std::map<std::string, BloomTree>& trees,
+                                  const AggregatedQueryTimings& queryTimings,
+                                  double fpp) {
+      size_t leafMemory = 0;
+      for (const auto& [column, tree] : trees) {
+        leafMemory += tree.leafMemorySize();
+      }
+      double bytesPerKey = static_cast<double>(leafMemory) /
+                           (static_cast<double>(dbSize) * trees.size());
+      std::ofstream leaf_filters("csv/exp_6_leaf_filters.csv", std::ios::app);
+      if (leaf_filters) {
+        leaf_filters << dbSize << "," << bloomSize << ","
+                     << leafFilterTypeName(type) << "," << leafMemory << ","
+                     << bytesPerKey << "," << fpp << ","
+                     << measureLeafProbeNanos(trees.begin()->second) << ","
+                     << queryTimings.hierarchicalSingleTimeStats.average << ","
+                     << queryTimings.hierarchicalMultiTimeStats.average << "\n";
+      }
+    };
+    writeLeafFilterRow(LeafFilterType::Bloom, hierarchies, timings,
+                       falsePositiveProb);
+
+    for (LeafFilterType type :
+         {LeafFilterType::BinaryFuse8, LeafFilterType::BinaryFuse16,
+          LeafFilterType::Ribbon8, LeafFilterType::Ribbon16}) {
+      TestParams leafParams = params;
+      leafParams.leafFilterType = type;
+      std::map<std::string, BloomTree> leafHierarchies =
+          buildHierarchies(columnSstFiles, bloomManager, leafParams);
+      AggregatedQueryTimings leafTimings = runStandardQueries(
+          dbManager, leafHierarchies, columns, dbSize, numQueryRuns, true);
+      const Node* leaf = leafHierarchies.begin()->second.leafNodes().front();
+      writeLeafFilterRow(type, leafHierarchies, leafTimings,
+                         leaf->leafFilter->falsePositiveRate());
+    }
+
+    // Tiered trees: leaf blooms paged out, a fraction of them cached
+    for (double cacheFraction : {0.1, 0.25, 0.5}) {
+      TestParams tieredParams = params;
+      size_t leafBytes = hierarchies.begin()->second.leafNodes().size() *
+                         ((bloomSize + 7) / 8);
+      tieredParams.leafCacheBytes = std::max<size_t>(
+          1, static_cast<size_t>(cacheFraction * leafBytes));
+      std::map<std::string, BloomTree> tieredHierarchies =
+          buildHierarchies(columnSstFiles, bloomManager, tieredParams);
+      AggregatedQueryTimings tieredTimings = runStandardQueries(
+          dbManager, tieredHierarchies, columns, dbSize, numQueryRuns, true);
+
+      size_t leafMemory = 0;
+      uint64_t hits = 0;
+      uint64_t lookups = 0;
+      for (const auto& [column, tree] : tieredHierarchies) {
+        leafMemory += tree.leafMemorySize();
+        if (const LeafFilterCache* cache = tree.leafCache()) {
+          hits += cache->hits();
+          lookups += cache->hits() + cache->misses();
+        }
+      }
+      std::ofstream tiered("csv/exp_6_tiered.csv", std::ios::app);
+      if (tiered) {
+        tiered << dbSize << "," << bloomSize << "," << cacheFraction << ","
+               << tieredParams.leafCacheBytes << "," << leafMemory << ","
+               << (lookups == 0 ? 1.0 : static_cast<double>(hits) / lookups)
+               << "," << tieredTimings.hierarchicalSingleTimeStats.average
+               << "," << tieredTimings.hierarchicalMultiTimeStats.average
+               << "\n";
+      }
+    }
+
     dbManager.closeDB();
   }
 }
\ No newline at end of file
@@ -25,6 +25,7 @@
 #include "exp_utils.hpp"
 #include "stopwatch.hpp"
 #include "test_params.hpp"
+#include "tree_catalog.hpp"
 
 extern void clearBloomFilterFiles(const std::string& dbDir);
 extern boost::asio::thread_pool globalThreadPool;
@@ -85,6 +86,244 @@ void writeExp7SelectedAvgChecksCSVHeaders() {
                  "scBloomAvg,scLeafAvg,scNonLeafAvg,scSSTAvg");
 }
 
+void writeExp7IncrementalCSVHeaders() {
+  writeCsvHeader("csv/exp_7_incremental.csv",
+                 "numRecords,keys,rebuildTime,incrementalUpdateTime,"
+                 "hierarchicalSingleTime_avg,hierarchicalMultiTime_avg,"
+                 "multiCol_sstChecks_avg,singleCol_sstChecks_avg");
+}
+
+void writeExp7RebuildLatencyCSVHeaders() {
+  writeCsvHeader("csv/exp_7_rebuild_latency.csv",
+                 "numRecords,phase,queries,p50Micros,p99Micros,maxMicros,"
+                 "treeVersion");
+}
+
+using Modification = std::tuple<std::string, std::string, std::string>;
+
+// Stores the current values of the first numTargetRecords target keys and
+// plans overwriting them with <column>_target, in the same order.
+static void planTargetModifications(
+    DBManager& dbManager, const TestParams& params,
+    const std::vector<std::string>& columns,
+    const std::vector<int>& targetRecordIndices, int numTargetRecords,
+    std::vector<Modification>& originalDataToRevert,
+    std::vector<Modification>& modificationsToApply) {
+  for (int i = 0; i < numTargetRecords; i++) {
+    int recordIndex = targetRecordIndices[i];
+    std::string currentKey =
+        createPrefixedKeyExp7(recordIndex, params.numRecords);
+    for (const auto& column : columns) {
+      try {
+        std::string originalValue = dbManager.getValue(column, currentKey);
+        originalDataToRevert.emplace_back(currentKey, column, originalValue);
+        spdlog::info("Exp7: Stored original for key '{}', col '{}': '{}'",
+                     currentKey, column, originalValue);
+      } catch (const std::exception& e) {
+        spdlog::warn(
+            "Exp7: Failed to get original value for key '{}', col '{}': {}. "
+            "Storing empty for revert.",
+            currentKey, column, e.what());
+        originalDataToRevert.emplace_back(currentKey, column, "");
+      }
+      modificationsToApply.emplace_back(currentKey, column, column + "_target");
+    }
+  }
+}
+
+// Moves every modified key from its value in `from` to the one in `to` in
+// the counting leaves of its column's tree, in the partition of the SST
+// file holding the key. The updates go into copies of the current trees,
+// published per column when done. Returns false if a new value could not
+// be indexed.
+static bool updateTreesInPlace(DBManager& dbManager, const std::string& dbName,
+                               TreeCatalog& catalog,
+                               const std::vector<Modification>& from,
+                               const std::vector<Modification>& to) {
+  std::shared_ptr<const TreeVersion> version = catalog.current();
+  std::map<std::string, BloomTree> updated;
+  bool indexed = true;
+  for (size_t i = 0; i < to.size(); ++i) {
+    const auto& [key, column, newValue] = to[i];
+    BloomTree& tree =
+        updated.try_emplace(column, version->trees.at(column)).first->second;
+    std::string file = dbManager.sstFileForKey(dbName, column, key);
+    if (!tree.applyValueUpdate(column, key, std::get<2>(from[i]), newValue,
+                               file)) {
+      indexed = false;
+    }
+  }
+  for (auto& [column, tree] : updated) {
+    catalog.publishColumn(column, std::move(tree));
+  }
+  return indexed;
+}
+
+// Fallback when an update found no leaf: flushes the writes and builds the
+// trees anew, so every current value is indexed again.
+static void rebuildTrees(DBManager& dbManager, BloomManager& bloomManager,
+                         const std::vector<std::string>& columns,
+                         const TestParams& params, TreeCatalog& catalog) {
+  spdlog::warn("Exp7: In-place update left values unindexed, rebuilding.");
+  dbManager.compactAllColumnFamilies(params.numRecords);
+  catalog.publish(buildHierarchies(scanSstFilesAsync(columns, dbManager, params),
+                                   bloomManager, params),
+                  dbManager.flushedSequence());
+}
+
+// Same workload as runExp7, but the trees are built once with counting
+// leaves and the overwrites are applied to them in place: no compaction,
+// no clearBloomFilterFiles and no rebuild per iteration.
+static void runExp7Incremental(const TestParams& baseParams,
+                               const std::vector<std::string>& columns,
+                               const std::vector<int>& targetItemsLoopVar,
+                               const std::vector<int>& targetRecordIndices,
+                               size_t dbSizeToUse, bool skipDbScan) {
+  TestParams params = baseParams;
+  params.countingLeaves = true;
+  DBManager dbManager;
+  BloomManager bloomManager;
+  TreeCatalog catalog(&dbManager);
+
+  dbManager.openDB(params.dbName, columns);
+  clearBloomFilterFiles(params.dbName);
+  std::map<std::string, std::vector<std::string>> columnSstFiles =
+      scanSstFilesAsync(columns, dbManager, params);
+  catalog.publish(buildHierarchies(columnSstFiles, bloomManager, params));
+  long long rebuildTime = 0;
+  for (const auto& [column, tree] : catalog.current()->trees) {
+    rebuildTime += tree.buildMicros;
+  }
+
+  std::vector<std::string> targetColumns;
+  for (const auto& column : columns) {
+    targetColumns.push_back(column + "_target");
+  }
+
+  for (const auto& numTargetRecords : targetItemsLoopVar) {
+    std::vector<Modification> originalDataToRevert;
+    std::vector<Modification> modificationsToApply;
+    planTargetModifications(dbManager, params, columns, targetRecordIndices,
+                            numTargetRecords, originalDataToRevert,
+                            modificationsToApply);
+
+    rocksdb::Status s_modify = dbManager.applyModifications(
+        modificationsToApply, params.numRecords, false);
+    if (!s_modify.ok()) {
+      spdlog::error("Exp7: Failed to apply modifications to target records: {}",
+                    s_modify.ToString());
+      dbManager.closeDB();
+      return;
+    }
+
+    StopWatch sw;
+    sw.start();
+    if (!updateTreesInPlace(dbManager, params.dbName, catalog,
+                            originalDataToRevert, modificationsToApply)) {
+      rebuildTrees(dbManager, bloomManager, columns, params, catalog);
+    }
+    sw.stop();
+    spdlog::info("Exp7: Updated {} values in place in {} µs.",
+                 modificationsToApply.size(), sw.elapsedMicros());
+
+    AggregatedQueryTimings timings =
+        runStandardQueriesWithTarget(dbManager, catalog.current()->trees,
+                                     columns, dbSizeToUse, 1, skipDbScan,
+                                     targetColumns);
+
+    std::ofstream incremental_csv_out("csv/exp_7_incremental.csv",
+                                      std::ios::app);
+    if (incremental_csv_out) {
+      incremental_csv_out << params.numRecords << "," << numTargetRecords << ","
+                          << rebuildTime << "," << sw.elapsedMicros() << ","
+                          << timings.hierarchicalSingleTimeStats.average << ","
+                          << timings.hierarchicalMultiTimeStats.average << ","
+                          << timings.multiCol_sstChecksStats.average << ","
+                          << timings.singleCol_sstChecksStats.average << "\n";
+    }
+
+    dbManager.revertModifications(originalDataToRevert, params.numRecords,
+                                  false);
+    if (!updateTreesInPlace(dbManager, params.dbName, catalog,
+                            modificationsToApply, originalDataToRevert)) {
+      rebuildTrees(dbManager, bloomManager, columns, params, catalog);
+    }
+  }
+  dbManager.closeDB();
+}
+
+static long long latencyPercentile(std::vector<long long> micros, double p) {
+  if (micros.empty()) return 0;
+  size_t rank = static_cast<size_t>(p * (micros.size() - 1));
+  std::nth_element(micros.begin(), micros.begin() + rank, micros.end());
+  return micros[rank];
+}
+
+// Multi-column query latency with the trees behind a TreeCatalog: first in
+// steady state, then while a full rebuild runs and publishes a new version.
+// Queries never wait for the rebuild; they run on whatever version is current.
+static void runExp7Rebuild(const TestParams& params,
+                           const std::vector<std::string>& columns,
+                           const std::vector<int>& targetRecordIndices) {
+  constexpr size_t kSteadyQueries = 50;
+  DBManager dbManager;
+  BloomManager bloomManager;
+  TreeCatalog catalog(&dbManager);
+
+  dbManager.openDB(params.dbName, columns);
+  clearBloomFilterFiles(params.dbName);
+  catalog.publish(buildHierarchies(
+      scanSstFilesAsync(columns, dbManager, params), bloomManager, params));
+
+  std::vector<std::vector<std::string>> queryValues;
+  for (int recordIndex : targetRecordIndices) {
+    std::string key = createPrefixedKeyExp7(recordIndex, params.numRecords);
+    std::vector<std::string> values;
+    for (const auto& column : columns) {
+      values.push_back(dbManager.getValue(column, key));
+    }
+    queryValues.push_back(std::move(values));
+  }
+
+  size_t next = 0;
+  auto timedQuery = [&]() {
+    std::shared_ptr<const TreeVersion> version = catalog.current();
+    std::vector<BloomTree> trees = version->treesFor(columns);
+    StopWatch sw;
+    sw.start();
+    multiColumnQueryHierarchical(trees, queryValues[next++ % queryValues.size()],
+                                 "", "", dbManager);
+    sw.stop();
+    return sw.elapsedMicros();
+  };
+
+  std::vector<long long> steady;
+  for (size_t i = 0; i < kSteadyQueries; ++i) steady.push_back(timedQuery());
+
+  std::vector<long long> duringRebuild;
+  std::future<uint64_t> rebuilt =
+      catalog.rebuildAsync(dbManager, bloomManager, columns, params);
+  while (rebuilt.wait_for(std::chrono::seconds(0)) !=
+         std::future_status::ready) {
+    duringRebuild.push_back(timedQuery());
+  }
+  uint64_t newVersion = rebuilt.get();
+
+  std::ofstream out("csv/exp_7_rebuild_latency.csv", std::ios::app);
+  if (out) {
+    auto writeRow = [&](const char* phase, const std::vector<long long>& micros,
+                        uint64_t version) {
+      out << params.numRecords << "," << phase << "," << micros.size() << ","
+          << latencyPercentile(micros, 0.5) << ","
+          << latencyPercentile(micros, 0.99) << ","
+          << latencyPercentile(micros, 1.0) << "," << version << "\n";
+    };
+    writeRow("steady", steady, newVersion - 1);
+    writeRow("rebuild", duringRebuild, newVersion);
+  }
+  dbManager.closeDB();
+}
+
 void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
              bool skipDbScan) {
   const std::vector<std::string> columns = {"phone", "mail", "address"};
@@ -110,41 +349,30 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
   writeExp7TimingsCSVHeaders();
   writeExp7OverviewCSVHeaders();
   writeExp7SelectedAvgChecksCSVHeaders();
+  writeExp7IncrementalCSVHeaders();
+  writeExp7RebuildLatencyCSVHeaders();
+
+  // The index is built once over the flushed data; the _target writes of
+  // each round stay in the memtable and are found through its delta.
+  dbManager.openDB(params.dbName, columns);
+  clearBloomFilterFiles(params.dbName);
+  std::map<std::string, std::vector<std::string>> columnSstFiles =
+      scanSstFilesAsync(columns, dbManager, params);
+  TreeCatalog catalog(&dbManager);
+  catalog.publish(buildHierarchies(columnSstFiles, bloomManager, params),
+                  dbManager.flushedSequence());
 
   for (const auto& numTargetRecords : targetItemsLoopVar) {
-    dbManager.openDB(params.dbName, columns);
-    std::vector<std::tuple<std::string, std::string, std::string>>
-        originalDataToRevert;
-    std::vector<std::tuple<std::string, std::string, std::string>>
-        modificationsToApply;
-    std::vector<std::string> currentExpectedValues;
-
-    for (int i = 0; i < numTargetRecords; i++) {
-      int recordIndex = targetRecordIndices[i];
-      std::string currentKey =
-          createPrefixedKeyExp7(recordIndex, params.numRecords);
-      for (const auto& column : columns) {
-        try {
-          std::string originalValue = dbManager.getValue(column, currentKey);
-          originalDataToRevert.emplace_back(currentKey, column, originalValue);
-          spdlog::info("Exp7: Stored original for key '{}', col '{}': '{}'",
-                       currentKey, column, originalValue);
-        } catch (const std::exception& e) {
-          spdlog::warn(
-              "Exp7: Failed to get original value for key '{}', col '{}': {}. "
-              "Storing empty for revert.",
-              currentKey, column, e.what());
-          originalDataToRevert.emplace_back(currentKey, column, "");
-        }
-        std::string targetValue = column + "_target";
-        modificationsToApply.emplace_back(currentKey, column, targetValue);
-        currentExpectedValues.push_back(targetValue);
-      }
-    }
+    std::vector<Modification> originalDataToRevert;
+    std::vector<Modification> modificationsToApply;
+    planTargetModifications(dbManager, params, columns, targetRecordIndices,
+                            numTargetRecords, originalDataToRevert,
+                            modificationsToApply);
 
     spdlog::info("Exp7: Applying modifications to DB...");
     rocksdb::Status s_modify =
-        dbManager.applyModifications(modificationsToApply, params.numRecords);
+        dbManager.applyModifications(modificationsToApply, params.numRecords,
+                                     false);
     if (!s_modify.ok()) {
       spdlog::error("Exp7: Failed to apply modifications to target records: {}",
                     s_modify.ToString());
@@ -152,21 +380,17 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
       return;
     }
 
-    clearBloomFilterFiles(params.dbName);
-
-    std::map<std::string, BloomTree> hierarchies;
-
-    std::map<std::string, std::vector<std::string>> columnSstFiles =
-        scanSstFilesAsync(columns, dbManager, params);
-
-    hierarchies = buildHierarchies(columnSstFiles, bloomManager, params);
     std::vector<std::string> targetColumns;
     for (const auto& column : columns) {
       targetColumns.push_back(column + "_target");
     }
-    AggregatedQueryTimings timings =
-        runStandardQueriesWithTarget(dbManager, hierarchies, columns,
-                                     dbSizeToUse, 1, skipDbScan, targetColumns);
+    // Queries of this round see the pinned trees' files and the writes
+    // above only
+    DBManager::QuerySnapshot pinned =
+        dbManager.pinQuerySnapshot(catalog.current());
+    AggregatedQueryTimings timings = runStandardQueriesWithTarget(
+        dbManager, pinned.version().trees, columns, dbSizeToUse, 1, skipDbScan,
+        targetColumns, &pinned);
 
     double falsePositiveProb = getProbabilityOfFalsePositive(
         params.bloomSize, params.numHashFunctions, params.itemsPerPartition);
@@ -291,8 +515,8 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
         << timings.singleCol_nonLeafBloomChecksStats.average << ","
         << timings.singleCol_sstChecksStats.average << "\n";
 
-    dbManager.revertModifications(originalDataToRevert, params.numRecords);
-    dbManager.closeDB();
+    dbManager.revertModifications(originalDataToRevert, params.numRecords,
+                                  false);
     checks_csv_out.close();
     derived_csv_out.close();
     per_column_csv_out.close();
@@ -300,6 +524,11 @@ void runExp7(const std::string& dbPathToUse, size_t dbSizeToUse,
     overview_csv_out.close();
     selected_avg_checks_csv_out.close();
   }
+  dbManager.closeDB();
+
+  runExp7Incremental(params, columns, targetItemsLoopVar, targetRecordIndices,
+                     dbSizeToUse, skipDbScan);
+  runExp7Rebuild(params, columns, targetRecordIndices);
 }
 
 void generateRandomIndexes(size_t dbSize, const int numTargetRecords,
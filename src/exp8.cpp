@@ -70,6 +70,20 @@ void writeExp8TimingComparisonHeaders() {
                  "avgHierarchicalMultiTime,avgHierarchicalSingleTime");
 }
 
+void writeExp8ColumnOrderingHeaders() {
+  writeCsvHeader("csv/exp_8_column_ordering.csv",
+                 "numRecords,numColumns,columnOrdering,realDataPercentage,"
+                 "avgMultiTime,avgMultiBloomChecks,avgMultiLeafBloomChecks,"
+                 "avgMultiNonLeafBloomChecks,avgMultiSSTChecks");
+}
+
+void writeExp8PlannerExplainHeaders() {
+  writeCsvHeader("csv/exp_8_planner_explain.csv",
+                 "numRecords,numColumns,realDataPercentage,isRealData,strategy,primaryColumn,"
+                 "estBloomChecks,actualBloomChecks,estSSTChecks,actualSSTChecks,"
+                 "estCostMicros,actualMicros");
+}
+
 void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
   const int dbSize = 20'000'000;
   const int maxColumns = 12;
@@ -86,6 +100,8 @@ void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
   writeExp8RealDataPerColumnHeaders();
   writeExp8ScalabilityHeaders();
   writeExp8TimingComparisonHeaders();
+  writeExp8ColumnOrderingHeaders();
+  writeExp8PlannerExplainHeaders();
 
   std::vector<std::string> allColumnNames;
   for (int i = 0; i < maxColumns; ++i) {
@@ -247,6 +263,47 @@ void runExp8(std::string baseDir, bool initMode, bool skipDbScan) {
     scalability_summary.close();
     timing_comparison.close();
 
+    // Same scenarios with selectivity-based column ordering switched off
+    spdlog::info("ExpBloomMetrics: Re-running comprehensive analysis for {} columns without column ordering",
+                 numCol);
+    gColumnOrderingEnabled = false;
+    std::vector<AccumulatedQueryMetrics> unorderedResults = runComprehensiveQueryAnalysis(
+        dbManager, hierarchies, currentColumns, dbSize, numQueriesPerScenario);
+    gColumnOrderingEnabled = true;
+
+    std::ofstream column_ordering("csv/exp_8_column_ordering.csv", std::ios::app);
+    if (column_ordering) {
+      auto writeOrderingRows = [&](const std::vector<AccumulatedQueryMetrics>& rows, bool ordering) {
+        for (const auto& result : rows) {
+          column_ordering << params.numRecords << "," << numCol << "," << (ordering ? 1 : 0) << ","
+                          << result.realDataPercentage << "," << result.avgHierarchicalMultiTime << ","
+                          << result.avgMultiBloomChecks << "," << result.avgMultiLeafBloomChecks << ","
+                          << result.avgMultiNonLeafBloomChecks << "," << result.avgMultiSSTChecks << "\n";
+        }
+      };
+      writeOrderingRows(comprehensiveResults, true);
+      writeOrderingRows(unorderedResults, false);
+      column_ordering.close();
+    }
+
+    // Cost-based planner: estimated vs. actual work per query
+    std::ofstream planner_explain("csv/exp_8_planner_explain.csv", std::ios::app);
+    for (double percentage : {0.0, 50.0, 100.0}) {
+      std::vector<PlannedQueryResult> planned = runPlannedQueriesWithCsvData(
+          dbManager, hierarchies, currentColumns, dbSize, numQueriesPerScenario / 5, percentage);
+      if (!planner_explain) continue;
+      for (const auto& result : planned) {
+        const auto& chosen = result.explain.plan.chosen;
+        planner_explain << params.numRecords << "," << numCol << "," << percentage << ","
+                        << result.isRealData << "," << queryStrategyName(chosen.strategy) << ","
+                        << chosen.primaryColumn << "," << chosen.bloomChecks << ","
+                        << result.explain.actualBloomChecks << "," << chosen.sstChecks << ","
+                        << result.explain.actualSSTChecks << "," << chosen.costMicros << ","
+                        << result.explain.actualMicros << "\n";
+      }
+    }
+    planner_explain.close();
+
     dbManager.closeDB();
   }
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <bit>
 #include <chrono>
 #include <cmath>
 #include <fstream>
@@ -15,6 +16,7 @@
 #include "bloomTree.hpp"
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
+#include "query_planner.hpp"
 #include "stopwatch.hpp"
 
 extern boost::asio::thread_pool globalThreadPool;
@@ -53,10 +55,24 @@ std::map<std::string, BloomTree> buildHierarchies(
     const std::map<std::string, std::vector<std::string>>& columnSstFiles,
     BloomManager& bloomManager, const TestParams& params) {
   std::map<std::string, BloomTree> hierarchies;
+  // Folding needs power-of-two filters
+  size_t bloomSize = params.bloomSize;
+  if ((params.internalFoldShift > 0 || params.internalBytesBudget > 0) &&
+      !std::has_single_bit(bloomSize)) {
+    bloomSize = std::bit_ceil(bloomSize);
+    spdlog::info("Bloom size rounded up to {} bits for folding.", bloomSize);
+  }
   for (const auto& [column, sstFiles] : columnSstFiles) {
     BloomTree hierarchy = bloomManager.createPartitionedHierarchy(
-        sstFiles, params.itemsPerPartition, params.bloomSize,
-        params.numHashFunctions, params.bloomTreeRatio);
+        sstFiles, params.itemsPerPartition, bloomSize,
+        params.numHashFunctions, params.bloomTreeRatio, params.buildValueIndex,
+        params.leafFilterType, params.countingLeaves, params.leafCacheBytes,
+        params.expectedPositiveRate, params.internalFoldShift,
+        params.childSlices);
+    if (params.internalBytesBudget > 0) {
+      hierarchy = hierarchy.foldedToBudget(params.internalBytesBudget);
+    }
+    hierarchy.column = column;
     spdlog::info("Hierarchy built for column: {}", column);
     hierarchies.try_emplace(column, std::move(hierarchy));
   }
@@ -76,6 +92,33 @@ void writeCsvHeader(const std::string& filename,
   out.close();
 }
 
+void writeTreeStatsHeader(const std::string& filename) {
+  writeCsvHeader(filename,
+                 "dbSize,itemsPerPartition,column,level,nodes,bytes,bits,"
+                 "setBits,passThrough,fill,estimatedCardinality,fpp");
+}
+
+void appendTreeStats(const std::string& filename, size_t dbSize,
+                     size_t itemsPerPartition,
+                     const std::map<std::string, BloomTree>& hierarchies) {
+  std::ofstream out(filename, std::ios::app);
+  if (!out) {
+    spdlog::error("Utils: Nie udało się otworzyć pliku '{}'!", filename);
+    return;
+  }
+  for (const auto& [column, tree] : hierarchies) {
+    TreeStats stats = tree.stats();
+    for (size_t level = 0; level < stats.levels.size(); ++level) {
+      const LevelStats& ls = stats.levels[level];
+      out << dbSize << "," << itemsPerPartition << "," << column << ","
+          << level << "," << ls.nodes << "," << ls.bytes << "," << ls.bits
+          << "," << ls.setBits << "," << ls.passThrough << "," << ls.fill
+          << ","
+          << ls.estimatedCardinality << "," << ls.fpp << "\n";
+    }
+  }
+}
+
 double getProbabilityOfFalsePositive(size_t bloomSize, int numHashFunctions,
                                      size_t itemsPerPartition) {
   if (bloomSize == 0) {
@@ -361,7 +404,8 @@ AggregatedQueryTimings runStandardQueries(
 AggregatedQueryTimings runStandardQueriesWithTarget(
     DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
     const std::vector<std::string>& columns, size_t dbSize, int numRuns,
-    bool skipDbScan, std::vector<std::string> currentExpectedValues) {
+    bool skipDbScan, std::vector<std::string> currentExpectedValues,
+    const DBManager::QuerySnapshot* snapshot) {
   AggregatedQueryTimings aggregated_timings;
 
   std::vector<long long> globalScanTimes, hierarchicalMultiTimes,
@@ -416,7 +460,8 @@ AggregatedQueryTimings runStandardQueriesWithTarget(
     if (!skipDbScan && i == 0) {
       stopwatch.start();
       [[maybe_unused]] std::vector<std::string> globalMatches =
-          dbManager.scanForRecordsInColumns(columns, currentExpectedValues);
+          dbManager.scanForRecordsInColumns(columns, currentExpectedValues,
+                                            snapshot);
       stopwatch.stop();
       globalScanTime = stopwatch.elapsedMicros();
     } else {
@@ -431,7 +476,7 @@ AggregatedQueryTimings runStandardQueriesWithTarget(
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> hierarchicalMatches =
         multiColumnQueryHierarchical(queryTrees, currentExpectedValues, "", "",
-                                     dbManager);
+                                     dbManager, snapshot);
     stopwatch.stop();
     hierarchicalMultiTimes.push_back(stopwatch.elapsedMicros());
     multiCol_bloomChecks_vec.push_back(gBloomCheckCount.load());
@@ -448,7 +493,7 @@ AggregatedQueryTimings runStandardQueriesWithTarget(
     stopwatch.start();
     [[maybe_unused]] std::vector<std::string> singlehierarchyMatches =
         dbManager.findUsingSingleHierarchy(queryTrees[0], columns,
-                                           currentExpectedValues);
+                                           currentExpectedValues, snapshot);
     stopwatch.stop();
     hierarchicalSingleTimes.push_back(stopwatch.elapsedMicros());
     singleCol_bloomChecks_vec.push_back(gBloomCheckCount.load());
@@ -902,6 +947,81 @@ std::vector<MixedQueryResult> runMixedQueriesWithCsvData(
   return results;
 }
 
+std::vector<PlannedQueryResult> runPlannedQueriesWithCsvData(
+    DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
+    const std::vector<std::string>& columns, size_t dbSize, int numQueries,
+    double realDataPercentage) {
+  std::vector<PlannedQueryResult> results;
+
+  if (hierarchies.empty() || columns.empty()) {
+    spdlog::warn(
+        "runPlannedQueriesWithCsvData: Hierarchies map or "
+        "columns vector is empty, skipping query execution.");
+    return results;
+  }
+
+  std::vector<BloomTree> queryTrees;
+  queryTrees.reserve(columns.size());
+  for (const auto& column : columns) {
+    auto it = hierarchies.find(column);
+    if (it == hierarchies.end()) {
+      spdlog::error(
+          "runPlannedQueriesWithCsvData: Hierarchy for column "
+          "'{}' not found. Skipping query execution.",
+          column);
+      return results;
+    }
+    queryTrees.push_back(it->second);
+  }
+
+  int numRealQueries = static_cast<int>(std::round(numQueries * realDataPercentage / 100.0));
+  std::vector<std::vector<bool>> patterns = generateDynamicPatterns(columns.size());
+
+  std::vector<bool> isRealDataQuery(numQueries, false);
+  for (int i = 0; i < numRealQueries; ++i) {
+    isRealDataQuery[i] = true;
+  }
+
+  std::random_device rd;
+  std::mt19937 generator(rd());
+  std::shuffle(isRealDataQuery.begin(), isRealDataQuery.end(), generator);
+  std::uniform_int_distribution<size_t> distribution(1, dbSize);
+
+  std::vector<std::string> currentExpectedValues;
+  results.reserve(numQueries);
+
+  for (int queryIdx = 0; queryIdx < numQueries; ++queryIdx) {
+    currentExpectedValues.clear();
+
+    bool useRealData = isRealDataQuery[queryIdx];
+    const std::vector<bool>& pattern =
+        useRealData ? patterns.back()
+                    : patterns[queryIdx % (patterns.size() - 1)];
+
+    size_t randomId = distribution(generator);
+    for (size_t colIdx = 0; colIdx < columns.size(); ++colIdx) {
+      currentExpectedValues.push_back(
+          columns[colIdx] + (pattern[colIdx] ? "_value" : "_wrong") +
+          std::to_string(randomId));
+    }
+
+    PlannedQueryResult result;
+    result.queryIndex = queryIdx;
+    result.isRealData = useRealData;
+
+    QueryPlan plan = planQuery(queryTrees, currentExpectedValues);
+    [[maybe_unused]] std::vector<std::string> matches = executeQueryPlan(
+        plan, queryTrees, columns, currentExpectedValues, dbManager,
+        &result.explain);
+    result.explain.log();
+
+    results.push_back(result);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  return results;
+}
+
 std::vector<AccumulatedQueryMetrics> runComprehensiveQueryAnalysis(
     DBManager& dbManager, const std::map<std::string, BloomTree>& hierarchies,
     const std::vector<std::string>& columns, size_t dbSize, int numQueriesPerScenario) {
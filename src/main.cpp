@@ -1,16 +1,19 @@
 #include <spdlog/spdlog.h>
 
 #include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <future>
 #include <iostream>
 #include <map>
+#include <new>
 #include <random>
 #include <regex>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "algorithm.hpp"
 #include "bloom_manager.hpp"
 #include "db_manager.hpp"
 #include "exp1.hpp"
@@ -26,8 +29,25 @@
 
 boost::asio::thread_pool globalThreadPool{std::thread::hardware_concurrency()};
 
+#ifdef COUNT_HEAP_ALLOCATIONS
+// Counts the heap allocations of each thread for tHeapAllocCount; built only
+// with make COUNT_ALLOCS=1, as it taxes every allocation in the process
+void* operator new(std::size_t size) {
+  ++tHeapAllocCount;
+  if (size == 0) size = 1;
+  while (true) {
+    if (void* p = std::malloc(size)) return p;
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) throw std::bad_alloc();
+    handler();
+  }
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
 void clearBloomFilterFiles(const std::string& dbDir) {
-  std::regex bloomFilePattern(R"(^\d+\.sst_[^_]+_[^_]+$)");
+  std::regex bloomFilePattern(R"(^\d+\.sst(_[^_]+_[^_]+|\.leaves\.\d+)$)");
   std::error_code ec;
 
   for (auto const& entry : std::filesystem::directory_iterator(dbDir, ec)) {
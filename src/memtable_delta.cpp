@@ -0,0 +1,88 @@
+#include "memtable_delta.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+MemtableDelta::MemtableDelta(size_t bloomSize, int numHashFunctions)
+    : bloom_(bloomSize, numHashFunctions) {}
+
+void MemtableDelta::recordWrite(const std::string& key,
+                                const std::string& value, uint64_t sequence) {
+  std::unique_lock lock(mutex_);
+  writes_[key].push_back(Write{value, sequence});
+  keysByValue_[value].insert(key);
+  bloom_.insert(value);
+}
+
+void MemtableDelta::releaseThrough(uint64_t sequence) {
+  std::unique_lock lock(mutex_);
+  // The bloom cannot drop values; it is rebuilt from the writes kept
+  bloom_ = BloomFilter(bloom_.bitArraySize, bloom_.numHashFunctions);
+  keysByValue_.clear();
+  for (auto it = writes_.begin(); it != writes_.end();) {
+    std::vector<Write>& writes = it->second;
+    writes.erase(writes.begin(),
+                 std::find_if(writes.begin(), writes.end(),
+                              [&](const Write& w) {
+                                return w.sequence > sequence;
+                              }));
+    if (writes.empty()) {
+      it = writes_.erase(it);
+      continue;
+    }
+    for (const Write& w : writes) {
+      keysByValue_[w.value].insert(it->first);
+      bloom_.insert(w.value);
+    }
+    ++it;
+  }
+}
+
+void MemtableDelta::clear() {
+  std::unique_lock lock(mutex_);
+  writes_.clear();
+  keysByValue_.clear();
+  bloom_ = BloomFilter(bloom_.bitArraySize, bloom_.numHashFunctions);
+}
+
+bool MemtableDelta::empty() const {
+  std::shared_lock lock(mutex_);
+  return writes_.empty();
+}
+
+bool MemtableDelta::mayContain(const std::string& value) const {
+  std::shared_lock lock(mutex_);
+  return bloom_.exists(value);
+}
+
+const MemtableDelta::Write* MemtableDelta::visibleWrite(
+    const std::string& key, uint64_t sequence) const {
+  auto it = writes_.find(key);
+  if (it == writes_.end()) return nullptr;
+  for (auto w = it->second.rbegin(); w != it->second.rend(); ++w) {
+    if (w->sequence <= sequence) return &*w;
+  }
+  return nullptr;
+}
+
+std::vector<std::string> MemtableDelta::keysWithValue(
+    const std::string& value, uint64_t sequence) const {
+  std::shared_lock lock(mutex_);
+  if (!bloom_.exists(value)) return {};
+  auto it = keysByValue_.find(value);
+  if (it == keysByValue_.end()) return {};
+  std::vector<std::string> keys;
+  for (const auto& key : it->second) {
+    const Write* w = visibleWrite(key, sequence);
+    if (w && w->value == value) keys.push_back(key);
+  }
+  return keys;
+}
+
+std::optional<std::string> MemtableDelta::latestValue(
+    const std::string& key, uint64_t sequence) const {
+  std::shared_lock lock(mutex_);
+  const Write* w = visibleWrite(key, sequence);
+  if (!w) return std::nullopt;
+  return w->value;
+}
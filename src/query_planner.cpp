@@ -0,0 +1,253 @@
+#include "query_planner.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "algorithm.hpp"
+#include "db_manager.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+
+struct ColumnEstimate {
+  double bloomChecks = 0.0;
+  double candidateLeaves = 0.0;
+  double presence = 0.0;     // 0 when the probe already ruled the value out
+  size_t probeChecks = 0;    // root + first level, checked exactly
+};
+
+// Root and first level are probed with the real value; deeper levels assume
+// one true path plus false positives at the level's sampled rate.
+ColumnEstimate estimateColumn(const BloomTree& tree, const TreeProfile& profile,
+                              const std::string& value) {
+  ColumnEstimate est;
+  const Node* root = tree.root;
+  est.probeChecks = 1;
+  est.bloomChecks = 1.0;
+  if (!root->mayContain(value)) return est;
+  if (root->children.empty()) {
+    est.candidateLeaves = 1.0;
+    est.presence = 1.0;
+    return est;
+  }
+
+  size_t passing = 0;
+  for (const Node* child : root->children) {
+    if (child->mayContain(value)) ++passing;
+  }
+  est.probeChecks += root->children.size();
+  est.bloomChecks += root->children.size();
+  if (passing == 0) return est;
+
+  est.presence = 1.0;
+  size_t depth = profile.levels.size();
+  if (depth == 2) {
+    est.candidateLeaves = static_cast<double>(passing);
+    return est;
+  }
+
+  double visited = passing * profile.fanout(1);
+  for (size_t l = 2; l < depth; ++l) {
+    visited = std::min(visited, static_cast<double>(profile.levels[l].nodes));
+    est.bloomChecks += visited;
+    double truePaths = std::min(est.presence, visited);
+    double passingAtLevel =
+        truePaths + (visited - truePaths) * profile.levels[l].fpp;
+    if (l + 1 == depth) {
+      est.candidateLeaves = passingAtLevel;
+    } else {
+      visited = passingAtLevel * profile.fanout(l);
+    }
+  }
+  return est;
+}
+
+double scanWaves(double scans, size_t parallelism) {
+  return std::ceil(scans / static_cast<double>(std::max<size_t>(1, parallelism)));
+}
+
+}  // namespace
+
+const char* queryStrategyName(QueryStrategy strategy) {
+  switch (strategy) {
+    case QueryStrategy::MultiColumn:
+      return "MultiColumn";
+    case QueryStrategy::SingleHierarchy:
+      return "SingleHierarchy";
+    case QueryStrategy::FullScan:
+      return "FullScan";
+  }
+  return "Unknown";
+}
+
+QueryPlan planQuery(const std::vector<BloomTree>& trees,
+                    const std::vector<std::string>& values,
+                    const PlannerCostModel& costModel) {
+  size_t n = trees.size();
+  if (n == 0 || n != values.size()) {
+    throw std::runtime_error(
+        "Number of trees and values must be equal and non-empty.");
+  }
+
+  // Profiles are taken when the trees are built; only the probe is per query
+  QueryPlan plan;
+  std::vector<const TreeProfile*> profiles;
+  std::vector<ColumnEstimate> columns;
+  profiles.reserve(n);
+  columns.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    profiles.push_back(&trees[i].profile());
+    columns.push_back(estimateColumn(trees[i], *profiles.back(), values[i]));
+    plan.planningBloomChecks += columns.back().probeChecks;
+  }
+
+  // Single hierarchy: one estimate per possible driving column.
+  for (size_t j = 0; j < n; ++j) {
+    StrategyEstimate est{QueryStrategy::SingleHierarchy, j};
+    est.bloomChecks = columns[j].bloomChecks;
+    est.sstChecks = columns[j].candidateLeaves;
+    est.costMicros =
+        est.bloomChecks * costModel.bloomCheckMicros +
+        scanWaves(est.sstChecks, costModel.scanParallelism) *
+            profiles[j]->rowsPerLeaf * costModel.partitionRowScanMicros +
+        columns[j].presence * (n - 1) * costModel.pointGetMicros;
+    plan.estimates.push_back(est);
+  }
+
+  // Multi-column: the ordering probe, the root checks and then the most
+  // selective column drives; the others only expand children overlapping the
+  // tightened key range of each surviving combination.
+  {
+    StrategyEstimate est{QueryStrategy::MultiColumn};
+    size_t orderingChecks = 0;
+    if (gColumnOrderingEnabled && n > 1) {
+      for (const auto& col : columns) orderingChecks += col.probeChecks;
+    }
+    auto firstOut = std::find_if(columns.begin(), columns.end(),
+                                 [](const ColumnEstimate& c) {
+                                   return c.presence == 0.0;
+                                 });
+    if (firstOut != columns.end()) {
+      size_t rootChecks = gColumnOrderingEnabled
+                              ? 1
+                              : static_cast<size_t>(firstOut - columns.begin()) + 1;
+      est.bloomChecks = static_cast<double>(orderingChecks + rootChecks);
+      est.sstChecks = 0.0;
+    } else {
+      size_t first = 0;
+      for (size_t i = 1; i < n; ++i) {
+        if (columns[i].candidateLeaves < columns[first].candidateLeaves) first = i;
+      }
+      double combos = columns[first].candidateLeaves;
+      double bloom = static_cast<double>(orderingChecks + n) +
+                     columns[first].bloomChecks - 1.0;
+      for (size_t i = 0; i < n; ++i) {
+        if (i == first) continue;
+        double perCombo = 0.0;
+        for (size_t l = 0; l + 1 < profiles[i]->levels.size(); ++l) {
+          perCombo += profiles[i]->fanout(l);
+        }
+        bloom += std::min(columns[i].bloomChecks, perCombo * combos);
+      }
+      est.bloomChecks = bloom;
+      est.sstChecks = static_cast<double>(n) * combos;
+    }
+    double rowsPerLeaf = 0.0;
+    for (const TreeProfile* p : profiles) rowsPerLeaf += p->rowsPerLeaf;
+    rowsPerLeaf /= n;
+    est.costMicros = est.bloomChecks * costModel.bloomCheckMicros +
+                     scanWaves(est.sstChecks, costModel.scanParallelism) *
+                         rowsPerLeaf * costModel.partitionRowScanMicros;
+    plan.estimates.push_back(est);
+  }
+
+  // Full scan: every row of the base column, no filters.
+  {
+    StrategyEstimate est{QueryStrategy::FullScan};
+    est.sstChecks = static_cast<double>(profiles[0]->levels.back().nodes);
+    est.costMicros = profiles[0]->totalRows * costModel.fullScanRowMicros;
+    plan.estimates.push_back(est);
+  }
+
+  plan.chosen = *std::min_element(
+      plan.estimates.begin(), plan.estimates.end(),
+      [](const StrategyEstimate& a, const StrategyEstimate& b) {
+        return a.costMicros < b.costMicros;
+      });
+  return plan;
+}
+
+std::vector<std::string> executeQueryPlan(
+    const QueryPlan& plan, std::vector<BloomTree>& trees,
+    const std::vector<std::string>& columns,
+    const std::vector<std::string>& values, DBManager& dbManager,
+    QueryExplain* explain) {
+  gBloomCheckCount = 0;
+  gLeafBloomCheckCount = 0;
+  gSSTCheckCount = 0;
+  gLeafCacheHitCount = 0;
+  gLeafCacheMissCount = 0;
+
+  StopWatch sw;
+  sw.start();
+  std::vector<std::string> results;
+  switch (plan.chosen.strategy) {
+    case QueryStrategy::MultiColumn:
+      results = multiColumnQueryHierarchical(trees, values, "", "", dbManager);
+      break;
+    case QueryStrategy::SingleHierarchy: {
+      // findUsingSingleHierarchy drives the lookup with the first column
+      size_t j = plan.chosen.primaryColumn;
+      std::vector<std::string> orderedColumns = columns;
+      std::vector<std::string> orderedValues = values;
+      std::swap(orderedColumns[0], orderedColumns[j]);
+      std::swap(orderedValues[0], orderedValues[j]);
+      results = dbManager.findUsingSingleHierarchy(trees[j], orderedColumns,
+                                                   orderedValues);
+      break;
+    }
+    case QueryStrategy::FullScan:
+      results = dbManager.scanForRecordsInColumns(columns, values);
+      break;
+  }
+  sw.stop();
+
+  if (explain) {
+    explain->plan = plan;
+    explain->actualBloomChecks = gBloomCheckCount.load();
+    explain->actualLeafBloomChecks = gLeafBloomCheckCount.load();
+    explain->actualSSTChecks = gSSTCheckCount.load();
+    explain->leafCacheHits = gLeafCacheHitCount.load();
+    explain->leafCacheMisses = gLeafCacheMissCount.load();
+    explain->actualMicros = sw.elapsedMicros();
+    explain->matches = results.size();
+  }
+  return results;
+}
+
+void QueryExplain::log() const {
+  spdlog::info("EXPLAIN chosen: {} (column {}), planner probes: {}",
+               queryStrategyName(plan.chosen.strategy),
+               plan.chosen.primaryColumn, plan.planningBloomChecks);
+  for (const auto& est : plan.estimates) {
+    spdlog::info(
+        "  {:<16} col {:>2} | est. bloom checks {:>9.1f} | est. SST checks "
+        "{:>7.1f} | est. cost {:>12.1f} µs",
+        queryStrategyName(est.strategy), est.primaryColumn, est.bloomChecks,
+        est.sstChecks, est.costMicros);
+  }
+  spdlog::info(
+      "  actual           | bloom checks {} ({} leaves) | SST checks {} | {} "
+      "µs | {} matches",
+      actualBloomChecks, actualLeafBloomChecks, actualSSTChecks, actualMicros,
+      matches);
+  if (leafCacheHits + leafCacheMisses > 0) {
+    spdlog::info("  leaf cache       | {} hits, {} misses, hit rate {:.3f}",
+                 leafCacheHits, leafCacheMisses,
+                 static_cast<double>(leafCacheHits) /
+                     (leafCacheHits + leafCacheMisses));
+  }
+}
@@ -0,0 +1,93 @@
+#include "tree_catalog.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <stdexcept>
+
+#include "bloom_manager.hpp"
+#include "db_manager.hpp"
+#include "exp_utils.hpp"
+
+std::vector<BloomTree> TreeVersion::treesFor(
+    const std::vector<std::string>& columns) const {
+  std::vector<BloomTree> result;
+  result.reserve(columns.size());
+  for (const auto& column : columns) {
+    auto it = trees.find(column);
+    if (it == trees.end()) {
+      throw std::runtime_error("No tree for column " + column +
+                               " in tree version " + std::to_string(id));
+    }
+    result.push_back(it->second);
+  }
+  return result;
+}
+
+std::shared_ptr<const TreeVersion> TreeCatalog::current() const {
+  return current_.load(std::memory_order_acquire);
+}
+
+uint64_t TreeCatalog::publish(std::map<std::string, BloomTree> trees,
+                              uint64_t flushedSequence) {
+  auto version = std::make_shared<TreeVersion>();
+  version->trees = std::move(trees);
+  version->flushedSequence = flushedSequence;
+  std::lock_guard lock(publishMutex_);
+  version->id = ++lastId_;
+  current_.store(std::move(version), std::memory_order_release);
+  spdlog::info("Published tree version {}", lastId_);
+  // Only now can queries find those writes through the trees
+  if (dbManager_ && flushedSequence > 0) {
+    dbManager_->releaseMemtableDeltas(flushedSequence);
+  }
+  return lastId_;
+}
+
+uint64_t TreeCatalog::publishColumn(const std::string& column,
+                                    BloomTree tree) {
+  std::lock_guard lock(publishMutex_);
+  auto version = std::make_shared<TreeVersion>();
+  if (auto old = current_.load(std::memory_order_acquire)) {
+    version->trees = old->trees;
+    version->flushedSequence = old->flushedSequence;
+  }
+  version->trees.insert_or_assign(column, std::move(tree));
+  version->id = ++lastId_;
+  current_.store(std::move(version), std::memory_order_release);
+  spdlog::info("Published tree version {} (column {})", lastId_, column);
+  return lastId_;
+}
+
+uint64_t TreeCatalog::foldToBudget(size_t internalBytes) {
+  std::lock_guard lock(publishMutex_);
+  auto old = current_.load(std::memory_order_acquire);
+  if (!old) {
+    throw std::runtime_error("No tree version to fold");
+  }
+  auto version = std::make_shared<TreeVersion>();
+  for (const auto& [column, tree] : old->trees) {
+    version->trees.emplace(column, tree.foldedToBudget(internalBytes));
+  }
+  version->flushedSequence = old->flushedSequence;
+  version->id = ++lastId_;
+  current_.store(std::move(version), std::memory_order_release);
+  spdlog::info("Published tree version {} (internal filters folded to {} "
+               "bytes per tree)",
+               lastId_, internalBytes);
+  return lastId_;
+}
+
+std::future<uint64_t> TreeCatalog::rebuildAsync(
+    DBManager& dbManager, BloomManager& bloomManager,
+    std::vector<std::string> columns, TestParams params) {
+  // Not on globalThreadPool: the build itself waits on tasks posted there
+  return std::async(std::launch::async, [this, &dbManager, &bloomManager,
+                                         columns = std::move(columns),
+                                         params = std::move(params)]() {
+    uint64_t flushed = dbManager.flushedSequence();
+    std::map<std::string, std::vector<std::string>> columnSstFiles =
+        scanSstFilesAsync(columns, dbManager, params);
+    return publish(buildHierarchies(columnSstFiles, bloomManager, params),
+                   flushed);
+  });
+}